@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow_xrt/api/api_internal.h"
 
+#include "oneflow_xrt/common/timer.h"
 #include "oneflow_xrt/compiler/passes/build_subgraph_pass.h"
 #include "oneflow_xrt/compiler/passes/mark_cluster_id_pass.h"
 #include "oneflow_xrt/compiler/passes/trainable_propagation_pass.h"
@@ -25,8 +26,15 @@ namespace xrt {
 std::shared_ptr<XrtGraph> RunClusterSubGraphPass(
     const XrtGraph* graph, const ClusteringOptions& options) {
   std::shared_ptr<XrtGraph> new_graph;
-  new_graph = TrainablePropagationPass(graph);
-  new_graph = RunMarkClusterIdPass(new_graph.get(), options);
+  {
+    ScopedTimer timer("TrainablePropagationPass");
+    new_graph = TrainablePropagationPass(graph);
+  }
+  {
+    ScopedTimer timer("MarkClusterIdPass");
+    new_graph = RunMarkClusterIdPass(new_graph.get(), options);
+  }
+  ScopedTimer timer("BuildSubGraphPass");
   return RunBuildSubGraphPass(new_graph.get(), options);
 }
 
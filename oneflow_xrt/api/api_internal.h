@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/job/job.pb.h"
 #include "oneflow_xrt/compiler/passes/options.h"
+#include "oneflow_xrt/compiler/passes/shape_inference_cache.h"
 #include "oneflow_xrt/compiler/passes/shape_inference_context.h"
 #include "oneflow_xrt/graph/graph.h"
 #include "oneflow_xrt/int8_calibration/calibration_mode.h"
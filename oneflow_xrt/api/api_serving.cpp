@@ -30,7 +30,14 @@ std::string CompileJob(const std::string& job,
                        bool cluster_ignore_pipeline,
                        size_t cluster_max_iteration,
                        bool cluster_strict_sbp_policy,
-                       const std::string& dump_subgraph_dir) {
+                       const std::string& dump_subgraph_dir,
+                       int64_t num_streams, int64_t host_num_threads,
+                       const std::string& host_thread_binding,
+                       const std::string& engine_cache_dir, bool use_bf16,
+                       bool share_weights,
+                       const std::string& xla_debug_options,
+                       const std::string& xla_dump_hlo_dir,
+                       bool xla_rematerialization) {
   Job job_proto;
   if (!job_proto.ParseFromString(job)) {
     LOG(FATAL) << "invalid serialized job";
@@ -52,6 +59,7 @@ std::string CompileJob(const std::string& job,
 
   ReBuildJobOptions options;
   options.use_fp16 = use_fp16;
+  options.use_bf16 = use_bf16;
   options.use_int8 = use_int8;
   options.max_batch_size = max_batch_size;
   options.max_workspace_size = max_workspace_size;
@@ -59,6 +67,14 @@ std::string CompileJob(const std::string& job,
   options.force_precision_constraints = force_precision_constraints;
   options.force_compile = force_compile;
   options.dump_subgraph_dir = dump_subgraph_dir;
+  options.num_streams = num_streams;
+  options.host_num_threads = host_num_threads;
+  options.host_thread_binding = host_thread_binding;
+  options.engine_cache_dir = engine_cache_dir;
+  options.share_weights = share_weights;
+  options.xla_debug_options = xla_debug_options;
+  options.xla_dump_hlo_dir = xla_dump_hlo_dir;
+  options.xla_rematerialization = xla_rematerialization;
 
   auto new_job = RunRebuildJobPass(graph.get(), job_proto, options);
   return new_job->SerializeAsString();
@@ -30,7 +30,12 @@ std::string CompileJob(
     size_t cluster_minimum_nodes = 1, size_t cluster_maximum_nodes = 0x7fffffff,
     bool cluster_ignore_pipeline = true, size_t cluster_max_iteration = 20,
     bool cluster_strict_sbp_policy = true,
-    const std::string& dump_subgraph_dir = "");
+    const std::string& dump_subgraph_dir = "", int64_t num_streams = 1,
+    int64_t host_num_threads = -1, const std::string& host_thread_binding = "",
+    const std::string& engine_cache_dir = "", bool use_bf16 = false,
+    bool share_weights = false, const std::string& xla_debug_options = "",
+    const std::string& xla_dump_hlo_dir = "",
+    bool xla_rematerialization = false);
 
 }  // namespace xrt
 }  // namespace oneflow
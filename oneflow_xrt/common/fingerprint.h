@@ -0,0 +1,48 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMMON_FINGERPRINT_H_
+#define ONEFLOW_XRT_COMMON_FINGERPRINT_H_
+
+#include <cstdint>
+#include <string>
+
+namespace oneflow {
+namespace xrt {
+
+// 64-bit FNV-1a hash, which is stable across processes and platforms, so it
+// can be used as the key of the persistent caches
+inline uint64_t Fingerprint64(const char* data, size_t size,
+                              uint64_t seed = 0xcbf29ce484222325ULL) {
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline uint64_t Fingerprint64(const std::string& data) {
+  return Fingerprint64(data.data(), data.size());
+}
+
+inline uint64_t FingerprintCat64(uint64_t fp1, uint64_t fp2) {
+  return Fingerprint64(reinterpret_cast<const char*>(&fp2), sizeof(fp2), fp1);
+}
+
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMMON_FINGERPRINT_H_
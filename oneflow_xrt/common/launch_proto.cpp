@@ -0,0 +1,236 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/common/launch_proto.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include "absl/strings/escaping.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/text_format.h"
+#include "oneflow_xrt/common/env.h"
+#include "oneflow_xrt/common/fingerprint.h"
+
+namespace oneflow {
+namespace xrt {
+
+namespace {
+
+constexpr char kBinaryLaunchProtoPrefix[] = "xrt-binary:";
+
+class LaunchProtoCache {
+ public:
+  static LaunchProtoCache* Global() {
+    static LaunchProtoCache cache;
+    return &cache;
+  }
+
+  std::shared_ptr<const XrtLaunchProto> Lookup(uint64_t fingerprint,
+                                               const std::string& attr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& it = records_.find(fingerprint);
+    // the attribute is compared to rule out the fingerprint collision
+    if (it == records_.end() || it->second.attr != attr) {
+      return nullptr;
+    }
+    return it->second.proto;
+  }
+
+  std::shared_ptr<const XrtLaunchProto> Insert(
+      uint64_t fingerprint, const std::string& attr,
+      std::shared_ptr<const XrtLaunchProto> proto) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& it = records_.find(fingerprint);
+    if (it != records_.end()) {
+      // keep the first one if the attribute has been parsed by other
+      // threads, and never cache the colliding one
+      return it->second.attr == attr ? it->second.proto : proto;
+    }
+    // the launch ops may be rebuilt many times in a long running process, so
+    // simply start over if the cache is too large
+    if (records_.size() >= capacity_) {
+      records_.clear();
+    }
+    records_.emplace(fingerprint, Record{attr, proto});
+    return proto;
+  }
+
+ private:
+  LaunchProtoCache()
+      : capacity_(EnvToInt64(ONEFLOW_XRT_LAUNCH_PROTO_CACHE_SIZE, 1024)) {}
+
+  struct Record {
+    std::string attr;
+    std::shared_ptr<const XrtLaunchProto> proto;
+  };
+
+  size_t capacity_;
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, Record> records_;
+};
+
+bool DoParseLaunchProto(const std::string& attr, XrtLaunchProto* proto) {
+  if (!absl::StartsWith(attr, kBinaryLaunchProtoPrefix)) {
+    return google::protobuf::TextFormat::ParseFromString(attr, proto);
+  }
+  std::string binary;
+  if (!absl::Base64Unescape(
+          absl::string_view(attr).substr(sizeof(kBinaryLaunchProtoPrefix) - 1),
+          &binary)) {
+    return false;
+  }
+  return proto->ParseFromString(binary);
+}
+
+// renames the ops and blobs of a launch function to the canonical names
+class LaunchProtoCanonicalizer {
+ public:
+  explicit LaunchProtoCanonicalizer(const FunctionProto& function) {
+    for (const auto& input : function.input()) {
+      blob_names_.emplace(input.value(), absl::StrCat("$", input.name()));
+    }
+    for (int i = 0; i < function.node_size(); ++i) {
+      op_names_.emplace(function.node(i).name(), absl::StrCat("$op", i));
+    }
+  }
+
+  std::string OpName(const std::string& name) const {
+    const auto& it = op_names_.find(name);
+    return (it == op_names_.end()) ? "$launch" : it->second;
+  }
+
+  // the blob names that can not be resolved are kept, which only makes the
+  // fingerprint depend on them
+  std::string BlobName(const std::string& lbn) const {
+    const auto& it = blob_names_.find(lbn);
+    if (it != blob_names_.end()) {
+      return it->second;
+    }
+    size_t pos = lbn.find('/');
+    if (pos != std::string::npos) {
+      const auto& op = op_names_.find(lbn.substr(0, pos));
+      if (op != op_names_.end()) {
+        return absl::StrCat(op->second, lbn.substr(pos));
+      }
+    }
+    return lbn;
+  }
+
+  bool Canonicalize(OperatorConf* conf) const {
+    if (!conf->has_user_conf()) {
+      return false;
+    }
+    conf->set_name(OpName(conf->name()));
+    auto* user_conf = conf->mutable_user_conf();
+    for (auto& it : *user_conf->mutable_input()) {
+      for (auto& lbn : *it.second.mutable_s()) {
+        lbn = BlobName(lbn);
+      }
+    }
+    for (auto& it : *user_conf->mutable_output()) {
+      for (auto& lbn : *it.second.mutable_s()) {
+        lbn = BlobName(lbn);
+      }
+    }
+    // clear the bookkeeping fields which differ between the layers but never
+    // affect the compiled results
+    const auto* descriptor = conf->GetDescriptor();
+    const auto* reflection = conf->GetReflection();
+    for (const char* field_name :
+         {"ctrl_in_op_name", "scope_symbol_id", "loc", "stream_name_hint"}) {
+      const auto* field = descriptor->FindFieldByName(field_name);
+      if (field) {
+        reflection->ClearField(conf, field);
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::unordered_map<std::string, std::string> op_names_;
+  std::unordered_map<std::string, std::string> blob_names_;
+};
+
+}  // namespace
+
+bool CanonicalizeLaunchProto(const XrtLaunchProto& proto,
+                             std::string* canonical_data) {
+  const FunctionProto& function = proto.function();
+  LaunchProtoCanonicalizer canonicalizer(function);
+
+  XrtLaunchProto canonical;
+  *canonical.mutable_options() = proto.options();
+  *canonical.mutable_liveout_entries() = proto.liveout_entries();
+  *canonical.mutable_variable_entries() = proto.variable_entries();
+  auto* canonical_function = canonical.mutable_function();
+  for (const auto& input : function.input()) {
+    auto* canonical_input = canonical_function->add_input();
+    canonical_input->set_name(input.name());
+    canonical_input->set_value(canonicalizer.BlobName(input.value()));
+  }
+  for (const auto& output : function.output()) {
+    auto* canonical_output = canonical_function->add_output();
+    canonical_output->set_name(output.name());
+    canonical_output->set_value(canonicalizer.BlobName(output.value()));
+  }
+  for (const auto& node : function.node()) {
+    OperatorConf* conf = canonical_function->add_node();
+    *conf = node;
+    if (!canonicalizer.Canonicalize(conf)) {
+      return false;
+    }
+  }
+  for (const auto& it : proto.nd_sbp_signatures()) {
+    (*canonical.mutable_nd_sbp_signatures())[canonicalizer.OpName(it.first)] =
+        it.second;
+  }
+  for (const auto& it : proto.logical_blob_descs()) {
+    (*canonical.mutable_logical_blob_descs())[canonicalizer.BlobName(
+        it.first)] = it.second;
+  }
+
+  // the map fields are sorted by the deterministic serialization
+  canonical_data->clear();
+  google::protobuf::io::StringOutputStream stream(canonical_data);
+  google::protobuf::io::CodedOutputStream output(&stream);
+  output.SetSerializationDeterministic(true);
+  return canonical.SerializeToCodedStream(&output);
+}
+
+std::string SerializeLaunchProto(const XrtLaunchProto& proto) {
+  return absl::StrCat(kBinaryLaunchProtoPrefix,
+                      absl::Base64Escape(proto.SerializeAsString()));
+}
+
+std::shared_ptr<const XrtLaunchProto> ParseLaunchProto(
+    const std::string& attr) {
+  auto* cache = LaunchProtoCache::Global();
+  uint64_t fingerprint = Fingerprint64(attr);
+  if (auto proto = cache->Lookup(fingerprint, attr)) {
+    return proto;
+  }
+  auto proto = std::make_shared<XrtLaunchProto>();
+  if (!DoParseLaunchProto(attr, proto.get())) {
+    return nullptr;
+  }
+  return cache->Insert(fingerprint, attr, proto);
+}
+
+}  // namespace xrt
+}  // namespace oneflow
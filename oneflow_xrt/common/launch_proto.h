@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMMON_LAUNCH_PROTO_H_
+#define ONEFLOW_XRT_COMMON_LAUNCH_PROTO_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "oneflow_xrt/xrt.pb.h"
+
+namespace oneflow {
+namespace xrt {
+
+// serialize the launch proto into the `proto` attribute of the xrt launch op.
+// The attribute is the binary proto encoded by base64 so that it's still a
+// printable string in the job
+std::string SerializeLaunchProto(const XrtLaunchProto& proto);
+
+// parse the launch proto from the `proto` attribute of the xrt launch op, and
+// return nullptr if failed. The parsed protos are shared by a process-wide
+// cache keyed by the fingerprint of the attribute, so each attribute is
+// parsed only once no matter how many times the launch op and kernel ask for
+// it. The cache is bounded by ONEFLOW_XRT_LAUNCH_PROTO_CACHE_SIZE (default
+// 1024). The text format attribute is also accepted for compatibility
+std::shared_ptr<const XrtLaunchProto> ParseLaunchProto(const std::string& attr);
+
+// serialize the launch proto deterministically in the canonical form which
+// does not depend on the names of the folded ops and blobs, so the clusters
+// of repeated layers have the same canonical data and can share the compiled
+// results. The ops are renamed by their order in the function, which follows
+// the unique ids of the folded nodes, and the blobs are renamed by their
+// producers, while the launch inputs and outputs keep
+// their positional names. Return false if the function contains the ops
+// other than user ops
+bool CanonicalizeLaunchProto(const XrtLaunchProto& proto,
+                             std::string* canonical_data);
+
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMMON_LAUNCH_PROTO_H_
@@ -0,0 +1,67 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMMON_PARALLEL_H_
+#define ONEFLOW_XRT_COMMON_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "oneflow_xrt/common/env.h"
+
+namespace oneflow {
+namespace xrt {
+
+// the maximum number of threads used by the compile-time passes, it can be
+// changed by the env `ONEFLOW_XRT_NUM_THREADS`
+inline int64_t NumParallelThreads() {
+  int64_t num_threads = EnvToInt64(ONEFLOW_XRT_NUM_THREADS,
+                                   std::thread::hardware_concurrency());
+  return std::max<int64_t>(num_threads, 1);
+}
+
+// run `func(i)` for all `i` in [0, size). The tasks are distributed to a
+// group of threads, so `func` must only write to the states owned by the
+// i-th task, and the callers merge the results in the index order
+template <typename Func>
+inline void ParallelFor(int64_t size, const Func& func) {
+  int64_t num_threads = std::min(size, NumParallelThreads());
+  if (num_threads <= 1) {
+    for (int64_t i = 0; i < size; ++i) {
+      func(i);
+    }
+    return;
+  }
+  std::atomic<int64_t> counter(0);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int64_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&]() {
+      for (int64_t i = counter++; i < size; i = counter++) {
+        func(i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMMON_PARALLEL_H_
@@ -0,0 +1,47 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMMON_TIMER_H_
+#define ONEFLOW_XRT_COMMON_TIMER_H_
+
+#include <chrono>
+#include <string>
+
+#include "glog/logging.h"
+
+namespace oneflow {
+namespace xrt {
+
+// log the elapsed time of a scope, set env GLOG_v=1 to see the details
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const std::string& name)
+      : name_(name), start_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedTimer() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_);
+    VLOG(1) << name_ << " takes " << elapsed.count() / 1000.0 << " ms";
+  }
+
+ private:
+  std::string name_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMMON_TIMER_H_
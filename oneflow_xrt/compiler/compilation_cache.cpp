@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include "oneflow_xrt/compiler/compilation_cache.h"
 
+#include "glog/logging.h"
+
 namespace oneflow {
 namespace xrt {
 
@@ -33,28 +35,94 @@ size_t SignatureHash::operator()(const Signature& signature) const {
   return hash_val;
 }
 
-Executable* CompilationCache::GetRecord(const Signature& signature) const {
-  Executable* record = nullptr;
+std::shared_ptr<Executable> CompilationCache::GetRecord(
+    const Signature& signature) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto& records = records_.find(signature.builder_name);
+  if (records == records_.end()) {
+    return nullptr;
+  }
+  const auto& it = records->second.find(signature);
+  if (it != records->second.end()) {
+    return it->second;
+  }
+  return nullptr;
+}
+
+std::shared_ptr<Executable> CompilationCache::GetCompatibleRecord(
+    const Signature& signature, const std::vector<Parameter>& entry_params) {
+  std::vector<std::shared_ptr<Executable>> candidates;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& records = records_.find(signature.builder_name);
+    if (records == records_.end()) {
+      return nullptr;
+    }
+    for (const auto& it : records->second) {
+      if (it.first.device_ordinal == signature.device_ordinal) {
+        candidates.push_back(it.second);
+      }
+    }
+  }
+  // the candidates are checked by the engines without holding the lock
+  for (const auto& candidate : candidates) {
+    if (candidate->IsCompatible(entry_params)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return records_[signature.builder_name]
+          .emplace(signature, candidate)
+          .first->second;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<Executable> CompilationCache::Record(
+    const Signature& signature, const std::shared_ptr<Executable>& result,
+    const Executable* outdated) {
   std::lock_guard<std::mutex> lock(mutex_);
-  const auto& it = records_.find(signature);
-  if (it != records_.end()) {
-    record = it->second.get();
+  auto& records = records_[signature.builder_name];
+  auto it = records.emplace(signature, result).first;
+  // replace the outdated record unless it has been replaced by others
+  if (outdated && it->second.get() == outdated) {
+    it->second = result;
   }
-  return record;
+  return it->second;
 }
 
-void CompilationCache::Record(const Signature& signature,
-                              const std::shared_ptr<Executable>& result) {
+bool CompilationCache::BindContent(const std::string& builder_name,
+                                   const std::string& content) {
   std::lock_guard<std::mutex> lock(mutex_);
-  records_.emplace(signature, result);
+  auto it = contents_.find(builder_name);
+  if (it == contents_.end()) {
+    it = contents_.emplace(builder_name, Content{content, 0}).first;
+  } else if (it->second.data != content) {
+    return false;
+  }
+  ++it->second.ref_count;
+  return true;
+}
+
+void CompilationCache::UnbindContent(const std::string& builder_name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = contents_.find(builder_name);
+  CHECK(it != contents_.end()) << "unbind the unknown name " << builder_name;
+  if (--it->second.ref_count == 0) {
+    contents_.erase(it);
+    records_.erase(builder_name);
+  }
 }
 
 void CompilationCache::Release() {
-  std::unordered_map<Signature, std::shared_ptr<Executable>, SignatureHash>
-      empty_records;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unordered_map<std::string, Records> empty_records;
   records_.swap(empty_records);
 }
 
+CompilationCache* SharedCompilationCache() {
+  static CompilationCache cache;
+  return &cache;
+}
+
 Signature ComputeSignature(const std::string& name, const int device_ordinal,
                            const std::vector<Parameter>& entry_params) {
   Signature signature;
@@ -47,19 +47,56 @@ struct SignatureHash {
 
 class CompilationCache {
  public:
-  Executable* GetRecord(const Signature& signature) const;
-
-  void Record(const Signature& signature,
-              const std::shared_ptr<Executable>& result);
+  // the records are returned as shared pointers, so that they are still
+  // alive while running even if they have been replaced by other callers
+  std::shared_ptr<Executable> GetRecord(const Signature& signature) const;
+
+  // lookup a record compatible with the entry params, and it will be shared
+  // with `signature` if found
+  std::shared_ptr<Executable> GetCompatibleRecord(
+      const Signature& signature, const std::vector<Parameter>& entry_params);
+
+  // insert the result if there is no record for `signature` or the record is
+  // still `outdated`, and return the record stored finally. The record
+  // recorded by the other callers is kept if they compiled concurrently
+  std::shared_ptr<Executable> Record(const Signature& signature,
+                                     const std::shared_ptr<Executable>& result,
+                                     const Executable* outdated = nullptr);
+
+  // bind the records named `builder_name` to the `content` they are compiled
+  // from, such as the canonical launch function. Return false if the name
+  // has been bound to different content, which means the name collides.
+  // Each successful binding holds a reference until `UnbindContent`
+  bool BindContent(const std::string& builder_name,
+                   const std::string& content);
+
+  // drop a reference of the binding, and the records named `builder_name`
+  // are released once no one holds the binding
+  void UnbindContent(const std::string& builder_name);
 
   void Release();
 
  private:
+  typedef std::unordered_map<Signature, std::shared_ptr<Executable>,
+                             SignatureHash>
+      Records;
+
+  struct Content {
+    std::string data;
+    int64_t ref_count = 0;
+  };
+
   mutable std::mutex mutex_;
-  std::unordered_map<Signature, std::shared_ptr<Executable>, SignatureHash>
-      records_;
+  // records indexed by the builder name
+  std::unordered_map<std::string, Records> records_;
+  std::unordered_map<std::string, Content> contents_;
 };
 
+// process-wide compilation cache shared by the launch ops whose functions
+// have the same canonical form, so that the clusters of repeated layers are
+// compiled only once
+CompilationCache* SharedCompilationCache();
+
 Signature ComputeSignature(const std::string& name, const int device_ordinal,
                            const std::vector<xrt::Parameter>& entry_params);
 
@@ -49,21 +49,34 @@ class Executable {
 
   const std::string& name() const { return name_; }
 
+  // The results are returned by each run rather than kept by the
+  // executable, since it may be run concurrently by the callers sharing it
   virtual bool Run(const std::vector<Parameter>& inputs,
                    const ExecutableRunOptions& run_options,
+                   std::vector<Parameter>* results,
                    bool block_until_done = true) = 0;
 
   bool RunAsync(const std::vector<Parameter> inputs,
-                const ExecutableRunOptions& run_options) {
-    return Run(inputs, run_options, false);
+                const ExecutableRunOptions& run_options,
+                std::vector<Parameter>* results) {
+    return Run(inputs, run_options, results, false);
   }
 
-  const std::vector<Parameter>& Results() const { return results_; }
+  // Return true if the executable should be recompiled for the inputs, such
+  // as the weights folded into it have been updated
+  virtual bool IsOutdated(const std::vector<Parameter>& inputs) const {
+    return false;
+  }
+
+  // Return true if the executable compiled for the other signature can also
+  // run the inputs, such as the network supporting dynamic batch
+  virtual bool IsCompatible(const std::vector<Parameter>& inputs) const {
+    return false;
+  }
 
  protected:
   std::string name_;
   XrtEngine engine_;
-  std::vector<Parameter> results_;
 };
 
 }  // namespace xrt
@@ -63,6 +63,12 @@ class GraphCompiler {
       device_ordinal_ = device_ordinal;
     }
 
+    void set_options(const ExecuteOptionsProto& options) {
+      options_ = options;
+    }
+
+    void set_fingerprint(uint64_t fingerprint) { fingerprint_ = fingerprint; }
+
     virtual std::shared_ptr<Executable> Compile(
         const XrtGraph* graph, const std::vector<Parameter>& entry_params,
         const std::vector<Parameter>& return_params,
@@ -72,6 +78,12 @@ class GraphCompiler {
     std::string name_ = "";
     XrtDevice device_;
     int32_t device_ordinal_ = 0;
+    // the options which take effect while compiling, such as the precision
+    // and the number of streams
+    ExecuteOptionsProto options_;
+    // fingerprint of the launch function, which identifies the compiled
+    // results together with the entry and return params
+    uint64_t fingerprint_ = 0;
   };
 
  public:
@@ -97,6 +109,14 @@ class GraphCompiler {
     return impl_->Compile(graph, entry_params, return_params, aliases);
   }
 
+  void set_options(const ExecuteOptionsProto& options) {
+    impl_->set_options(options);
+  }
+
+  void set_fingerprint(uint64_t fingerprint) {
+    impl_->set_fingerprint(fingerprint);
+  }
+
   const XrtEngine& engine() const { return engine_; }
 
  private:
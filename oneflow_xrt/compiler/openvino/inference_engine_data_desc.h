@@ -32,6 +32,8 @@ inline InferenceEngine::Precision DataTypeToPrecision(
       return InferenceEngine::Precision::FP32;
     case oneflow::kFloat16:
       return InferenceEngine::Precision::FP16;
+    case oneflow::kBFloat16:
+      return InferenceEngine::Precision::BF16;
     case oneflow::kInt8:
       return InferenceEngine::Precision::I8;
     case oneflow::kInt32:
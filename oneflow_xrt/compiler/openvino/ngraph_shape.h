@@ -34,8 +34,12 @@ inline ngraph::element::Type DataTypeToNgraphDataType(
       return ngraph::element::f32;
     case oneflow::kFloat16:
       return ngraph::element::f16;
+    case oneflow::kBFloat16:
+      return ngraph::element::bf16;
     case oneflow::kInt8:
       return ngraph::element::i8;
+    case oneflow::kUInt8:
+      return ngraph::element::u8;
     case oneflow::kInt32:
       return ngraph::element::i32;
     case oneflow::kInt64:
@@ -57,6 +61,31 @@ inline ngraph::Shape ShapeToNgraphShape(const Shape& shape) {
   return ngraph::Shape(dim_vec);
 }
 
+// reshape `input` to `shape`, and the first dimension of the target shape is
+// copied or inferred from the input if it's the batch dimension kept or
+// flattened with the others. So that the network can be reshaped to another
+// batch size
+inline std::shared_ptr<ngraph::Node> BatchAgnosticReshape(
+    const std::shared_ptr<ngraph::Node>& input, const Shape& shape) {
+  const ngraph::Shape& in_shape = input->get_output_shape(0);
+  std::vector<int64_t> pattern(shape.dim_vec().begin(), shape.dim_vec().end());
+  bool special_zero = false;
+  if (!pattern.empty() && !in_shape.empty() && in_shape[0] > 0 &&
+      pattern[0] > 0) {
+    if (pattern[0] == in_shape[0]) {
+      pattern[0] = 0;
+      special_zero = true;
+    } else if (pattern[0] % in_shape[0] == 0 ||
+               in_shape[0] % pattern[0] == 0) {
+      pattern[0] = -1;
+    }
+  }
+  auto pattern_node = std::make_shared<ngraph::op::Constant>(
+      ngraph::element::i64, ngraph::Shape({pattern.size()}), pattern);
+  return std::make_shared<ngraph::op::v1::Reshape>(input, pattern_node,
+                                                   special_zero);
+}
+
 class NgraphShape {
  public:
   NgraphShape() = default;
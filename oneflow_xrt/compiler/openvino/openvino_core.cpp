@@ -0,0 +1,148 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/openvino/openvino_core.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+#include "oneflow_xrt/common/env.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+InferenceEngine::Core* GetInferenceEngineCore() {
+  static InferenceEngine::Core core;
+  return &core;
+}
+
+std::map<std::string, std::string> MakeLoadNetworkConfig(
+    const ExecuteOptionsProto& options) {
+  std::map<std::string, std::string> config;
+  // throughput mode runs the concurrent executions on multiple cpu streams,
+  // and binds the stream threads to the numa nodes by default
+  if (options.num_streams() != 1) {
+    config[CONFIG_KEY(CPU_THROUGHPUT_STREAMS)] =
+        options.num_streams() > 0 ? std::to_string(options.num_streams())
+                                  : CONFIG_VALUE(CPU_THROUGHPUT_AUTO);
+    config[CONFIG_KEY(CPU_BIND_THREAD)] = CONFIG_VALUE(NUMA);
+  }
+
+  int64_t num_threads = options.host_num_threads();
+  if (num_threads <= 0) {
+    // divide the cores equally by the processes launched on the same
+    // machine, otherwise each of them will occupy all the cores
+    int64_t local_world_size = EnvToInt64(LOCAL_WORLD_SIZE, 1);
+    if (local_world_size > 1) {
+      num_threads = std::max<int64_t>(
+          std::thread::hardware_concurrency() / local_world_size, 1);
+    }
+  }
+  if (num_threads > 0) {
+    config[CONFIG_KEY(CPU_THREADS_NUM)] = std::to_string(num_threads);
+  }
+
+  const std::string& binding = options.host_thread_binding();
+  if (binding == "NONE") {
+    config[CONFIG_KEY(CPU_BIND_THREAD)] = CONFIG_VALUE(NO);
+  } else if (binding == "CORE") {
+    config[CONFIG_KEY(CPU_BIND_THREAD)] = CONFIG_VALUE(YES);
+  } else if (binding == "NUMA") {
+    config[CONFIG_KEY(CPU_BIND_THREAD)] = CONFIG_VALUE(NUMA);
+  } else {
+    CHECK(binding.empty()) << "unsupported host thread binding " << binding
+                           << ", it should be NONE, CORE or NUMA";
+  }
+
+  // low precision on cpu is bf16, which is enabled for both fp16 and bf16
+  // since the cpu plugin has no fp16 kernels. And the inputs and outputs
+  // are still in their precisions which are converted by the plugin
+  if (options.use_bf16() || options.use_fp16()) {
+    const auto& capabilities =
+        GetInferenceEngineCore()
+            ->GetMetric("CPU", METRIC_KEY(OPTIMIZATION_CAPABILITIES))
+            .as<std::vector<std::string>>();
+    if (std::find(capabilities.begin(), capabilities.end(),
+                  METRIC_VALUE(BF16)) != capabilities.end()) {
+      config[CONFIG_KEY(ENFORCE_BF16)] = CONFIG_VALUE(YES);
+    } else {
+      VLOG(2) << "OpenVINO couldn't use bf16 precision since the CPU "
+                 "hardware does not support.";
+    }
+  } else if (options.strict_types()) {
+    // keep fp32 precision, otherwise the plugin may choose bf16 by default
+    // on the cpus supporting it
+    config[CONFIG_KEY(ENFORCE_BF16)] = CONFIG_VALUE(NO);
+  }
+
+  // enable the model caching of the inference engine for the plugins
+  // supporting it, and the cpu networks are cached by `LoadNetwork`
+  if (!options.engine_cache_dir().empty()) {
+    config[CONFIG_KEY(CACHE_DIR)] = options.engine_cache_dir();
+  }
+  return config;
+}
+
+InferenceEngine::ExecutableNetwork LoadNetwork(
+    const InferenceEngine::CNNNetwork& network,
+    const std::map<std::string, std::string>& config,
+    const std::string& cache_dir, uint64_t key) {
+  auto* core = GetInferenceEngineCore();
+  if (cache_dir.empty()) {
+    return core->LoadNetwork(network, "CPU", config);
+  }
+  std::string path = absl::StrCat(cache_dir, "/xrt_openvino_",
+                                  absl::Hex(key, absl::kZeroPad16), ".blob");
+  {
+    std::ifstream ifs(path, std::ios::binary);
+    if (ifs.good()) {
+      try {
+        return core->ImportNetwork(ifs, "CPU", config);
+      } catch (const std::exception& e) {
+        LOG(WARNING) << "failed to import the cached network " << path << " ("
+                     << e.what() << "), it will be compiled again";
+      }
+    }
+  }
+  auto executable_network = core->LoadNetwork(network, "CPU", config);
+  // export to a temporary file and then rename it, so the other processes
+  // never see an incomplete blob
+  std::string temp_path = absl::StrCat(path, ".", getpid(), ".tmp");
+  {
+    std::ofstream ofs(temp_path, std::ios::binary);
+    if (!ofs.good()) {
+      LOG(WARNING) << "can not export the network to " << temp_path
+                   << ", please check if the directory (" << cache_dir
+                   << ") exists";
+      return executable_network;
+    }
+    executable_network.Export(ofs);
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+  }
+  return executable_network;
+}
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
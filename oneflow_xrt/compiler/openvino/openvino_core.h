@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_CORE_H_
+#define ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_CORE_H_
+
+#include <inference_engine.hpp>
+#include <map>
+#include <string>
+
+#include "oneflow_xrt/xrt.pb.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+// the process-wide inference engine core shared by all the openvino
+// executables, so that the plugins are loaded only once
+InferenceEngine::Core* GetInferenceEngineCore();
+
+// make the cpu plugin config for loading network according to the execute
+// options, including the number of streams, threads and the thread binding
+std::map<std::string, std::string> MakeLoadNetworkConfig(
+    const ExecuteOptionsProto& options);
+
+// load the network on cpu. If `cache_dir` is not empty, the network is
+// imported from the blob exported by the previous processes with the same
+// `key`, or it will be compiled and exported for the later processes
+InferenceEngine::ExecutableNetwork LoadNetwork(
+    const InferenceEngine::CNNNetwork& network,
+    const std::map<std::string, std::string>& config,
+    const std::string& cache_dir, uint64_t key);
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_CORE_H_
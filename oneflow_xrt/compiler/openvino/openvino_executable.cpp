@@ -15,63 +15,262 @@ limitations under the License.
 */
 #include "oneflow_xrt/compiler/openvino/openvino_executable.h"
 
+#include <cstring>
+
 #include "oneflow_xrt/common/device.h"
+#include "oneflow_xrt/common/fingerprint.h"
 
 namespace oneflow {
 namespace xrt {
 namespace openvino {
 
-bool OpenvinoExecutable::Run(const std::vector<Parameter>& inputs,
-                             const ExecutableRunOptions& run_options,
-                             bool block_until_done) {
-  InferenceEngine::InferRequest::Ptr infer_request =
-      executable_network_->CreateInferRequestPtr();
-
-  InferenceEngine::ConstInputsDataMap input_info(
-      executable_network_->GetInputsInfo());
-  InferenceEngine::ConstOutputsDataMap output_info(
-      executable_network_->GetOutputsInfo());
-  for (auto input_info_iter = input_info.begin();
-       input_info_iter != input_info.end(); ++input_info_iter) {
-    auto it = in_out_to_param_idx_.find(input_info_iter->first);
+OpenvinoExecutable::OpenvinoExecutable(
+    const std::string& name,
+    std::unique_ptr<InferenceEngine::ExecutableNetwork> network,
+    const std::unordered_map<std::string, int>& in_out_to_param_idx,
+    bool throughput_mode, OpenvinoInt8CalibratorResource* calibrator_resource,
+    const std::unordered_map<std::string, std::string>& calibration_tensors,
+    const std::vector<WeightVersion>& weight_versions,
+    const DynamicBatch& dynamic_batch)
+    : Executable(name, XrtEngine::OPENVINO),
+      executable_network_(std::move(network)),
+      in_out_to_param_idx_(in_out_to_param_idx),
+      throughput_mode_(throughput_mode),
+      calibrator_resource_(calibrator_resource),
+      calibration_tensors_(calibration_tensors),
+      weight_versions_(weight_versions),
+      dynamic_batch_(dynamic_batch) {
+  auto MakeBinding = [&](const std::string& name) -> BlobBinding {
+    auto it = in_out_to_param_idx_.find(name);
     CHECK(it != in_out_to_param_idx_.end());
-    const int input_idx = it->second;
-    CHECK_LT(input_idx, inputs.size());
-    CHECK_EQ(infer_request->GetBlob(input_info_iter->first)->byteSize(),
-             inputs[input_idx].byte_size());
-    InferenceEngineDataDesc data_desc(inputs[input_idx].shape(),
-                                      inputs[input_idx].data_type());
-    InferenceEngine::TensorDesc in_desc(data_desc.precision(), data_desc.dims(),
-                                        data_desc.layout());
-    InferenceEngine::Blob::Ptr in_blob =
-        ParameterToBlobPtr(inputs[input_idx], in_desc);
-    infer_request->SetBlob(input_info_iter->first, in_blob);
+    return BlobBinding{name, it->second, dynamic_batch_.max_batch_size > 0};
+  };
+  for (const auto& input : executable_network_->GetInputsInfo()) {
+    input_bindings_.emplace_back(MakeBinding(input.first));
+    auto& binding = input_bindings_.back();
+    if (binding.batched) {
+      binding.batched = dynamic_batch_.batched_entries.at(binding.param_idx);
+    }
+  }
+  for (const auto& output : executable_network_->GetOutputsInfo()) {
+    // the extra outputs only for calibration are owned by the infer request
+    if (calibration_tensors_.count(output.first) > 0 &&
+        in_out_to_param_idx_.count(output.first) == 0) {
+      continue;
+    }
+    output_bindings_.emplace_back(MakeBinding(output.first));
+  }
+  if (throughput_mode_) {
+    // prepare the optimal number of requests to keep all streams busy
+    unsigned int num_requests =
+        executable_network_
+            ->GetMetric(METRIC_KEY(OPTIMAL_NUMBER_OF_INFER_REQUESTS))
+            .as<unsigned int>();
+    std::vector<std::unique_ptr<InferRequestSlot>> slots;
+    for (unsigned int i = 0; i < num_requests; ++i) {
+      slots.emplace_back(AcquireInferRequest());
+    }
+    for (auto& slot : slots) {
+      ReleaseInferRequest(std::move(slot));
+    }
+  }
+}
+
+void OpenvinoExecutable::InitTensorDescs(
+    const std::vector<Parameter>& inputs,
+    const std::vector<Parameter>& outputs) {
+  auto MakeTensorDesc = [](const Parameter& param) {
+    InferenceEngineDataDesc data_desc(param.shape(), param.data_type());
+    return InferenceEngine::TensorDesc(data_desc.precision(), data_desc.dims(),
+                                       data_desc.layout());
+  };
+  for (const auto& binding : input_bindings_) {
+    CHECK_LT(binding.param_idx, inputs.size());
+    input_descs_.emplace_back(MakeTensorDesc(inputs[binding.param_idx]));
+  }
+  for (const auto& binding : output_bindings_) {
+    CHECK_LT(binding.param_idx, outputs.size());
+    output_descs_.emplace_back(MakeTensorDesc(outputs[binding.param_idx]));
+  }
+}
+
+auto OpenvinoExecutable::AcquireInferRequest()
+    -> std::unique_ptr<InferRequestSlot> {
+  {
+    std::lock_guard<std::mutex> lock(requests_mutex_);
+    if (!idle_requests_.empty()) {
+      auto slot = std::move(idle_requests_.back());
+      idle_requests_.pop_back();
+      return slot;
+    }
+  }
+  auto slot = std::make_unique<InferRequestSlot>();
+  slot->request = executable_network_->CreateInferRequestPtr();
+  slot->input_data.resize(input_bindings_.size(), nullptr);
+  slot->output_data.resize(output_bindings_.size(), nullptr);
+  return slot;
+}
+
+void OpenvinoExecutable::ReleaseInferRequest(
+    std::unique_ptr<InferRequestSlot> slot) {
+  std::lock_guard<std::mutex> lock(requests_mutex_);
+  idle_requests_.emplace_back(std::move(slot));
+}
+
+void OpenvinoExecutable::BindBlob(InferenceEngine::InferRequest* request,
+                                  const BlobBinding& binding,
+                                  const InferenceEngine::TensorDesc& desc,
+                                  const Parameter& param, void** bound_data) {
+  // the blob still wraps the same memory since the last run
+  if (*bound_data == param.data()) {
+    return;
   }
+  if (*bound_data == nullptr) {
+    CHECK_EQ(request->GetBlob(binding.name)->byteSize(), param.byte_size());
+  }
+  request->SetBlob(binding.name, ParameterToBlobPtr(param, desc));
+  *bound_data = param.data();
+}
 
+bool OpenvinoExecutable::Run(const std::vector<Parameter>& inputs,
+                             const ExecutableRunOptions& run_options,
+                             std::vector<Parameter>* results,
+                             bool block_until_done) {
   // all return params are the results of the executable
-  this->results_ = run_options.return_params;
+  *results = run_options.return_params;
 
-  for (auto output_info_iter = output_info.begin();
-       output_info_iter != output_info.end(); ++output_info_iter) {
-    auto it = in_out_to_param_idx_.find(output_info_iter->first);
-    CHECK(it != in_out_to_param_idx_.end());
-    const int output_idx = it->second;
-    CHECK_LT(output_idx, this->results_.size());
-    CHECK_EQ(infer_request->GetBlob(output_info_iter->first)->byteSize(),
-             this->results_[output_idx].byte_size());
-    InferenceEngineDataDesc data_desc(this->results_[output_idx].shape(),
-                                      this->results_[output_idx].data_type());
-    InferenceEngine::TensorDesc out_desc(data_desc.precision(),
-                                         data_desc.dims(), data_desc.layout());
-    InferenceEngine::Blob::Ptr out_blob =
-        ParameterToBlobPtr(this->results_[output_idx], out_desc);
-    infer_request->SetBlob(output_info_iter->first, out_blob);
-  }
-
-  infer_request->Infer();
+  std::call_once(tensor_descs_flag_,
+                 [&]() { InitTensorDescs(inputs, *results); });
+
+  auto slot = AcquireInferRequest();
+  InferenceEngine::InferRequest* request = slot->request.get();
+  int64_t batch_size = -1;
+  for (int i = 0; i < input_bindings_.size(); ++i) {
+    const auto& binding = input_bindings_[i];
+    const Parameter& input = inputs[binding.param_idx];
+    if (binding.batched) {
+      CopyToBlob(request, binding, input);
+      batch_size = input.shape().At(0);
+    } else {
+      BindBlob(request, binding, input_descs_[i], input, &slot->input_data[i]);
+    }
+  }
+  for (int i = 0; i < output_bindings_.size(); ++i) {
+    const auto& binding = output_bindings_[i];
+    if (!binding.batched) {
+      BindBlob(request, binding, output_descs_[i],
+               (*results)[binding.param_idx], &slot->output_data[i]);
+    }
+  }
+  if (batch_size > 0) {
+    request->SetBatch(batch_size);
+  }
+
+  // the run always blocks regardless of `block_until_done`. The cpu stream
+  // has no event to be synchronized with the infer request, so the results
+  // must be ready before the launch kernel returns
+  if (throughput_mode_) {
+    request->StartAsync();
+    request->Wait(InferenceEngine::InferRequest::WaitMode::RESULT_READY);
+  } else {
+    request->Infer();
+  }
+  for (const auto& binding : output_bindings_) {
+    if (binding.batched) {
+      CopyFromBlob(request, binding, (*results)[binding.param_idx]);
+    }
+  }
+  if (calibrator_resource_ && !calibrator_resource_->IsDone()) {
+    CollectCalibrationRanges(request);
+  }
+  ReleaseInferRequest(std::move(slot));
   return true;
 }
 
+bool OpenvinoExecutable::IsOutdated(
+    const std::vector<Parameter>& inputs) const {
+  for (const auto& version : weight_versions_) {
+    CHECK_LT(version.param_idx, inputs.size());
+    const Parameter& weight = inputs[version.param_idx];
+    if (weight.data() != version.data) {
+      return true;
+    }
+    if (version.check_contents &&
+        Fingerprint64(weight.data<char>(), weight.byte_size()) !=
+            version.fingerprint) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OpenvinoExecutable::IsCompatible(
+    const std::vector<Parameter>& inputs) const {
+  const auto& entry_shapes = dynamic_batch_.entry_shapes;
+  if (dynamic_batch_.max_batch_size <= 0 ||
+      inputs.size() != entry_shapes.size()) {
+    return false;
+  }
+  int64_t batch_size = -1;
+  for (int i = 0; i < inputs.size(); ++i) {
+    const Shape& shape = inputs[i].shape();
+    if (!dynamic_batch_.batched_entries[i]) {
+      if (shape != entry_shapes[i]) {
+        return false;
+      }
+      continue;
+    }
+    if (shape.NumAxes() != entry_shapes[i].NumAxes() ||
+        (batch_size > 0 && shape.At(0) != batch_size)) {
+      return false;
+    }
+    for (int j = 1; j < shape.NumAxes(); ++j) {
+      if (shape.At(j) != entry_shapes[i].At(j)) {
+        return false;
+      }
+    }
+    batch_size = shape.At(0);
+  }
+  return batch_size > 0 && batch_size <= dynamic_batch_.max_batch_size;
+}
+
+void OpenvinoExecutable::CopyToBlob(InferenceEngine::InferRequest* request,
+                                    const BlobBinding& binding,
+                                    const Parameter& param) {
+  auto blob = InferenceEngine::as<InferenceEngine::MemoryBlob>(
+      request->GetBlob(binding.name));
+  CHECK(blob) << "blob " << binding.name << " is not a memory blob";
+  CHECK_LE(param.byte_size(), blob->byteSize());
+  auto holder = blob->wmap();
+  std::memcpy(holder.as<void*>(), param.data(), param.byte_size());
+}
+
+void OpenvinoExecutable::CopyFromBlob(InferenceEngine::InferRequest* request,
+                                      const BlobBinding& binding,
+                                      const Parameter& param) {
+  auto blob = InferenceEngine::as<InferenceEngine::MemoryBlob>(
+      request->GetBlob(binding.name));
+  CHECK(blob) << "blob " << binding.name << " is not a memory blob";
+  CHECK_LE(param.byte_size(), blob->byteSize());
+  auto holder = blob->rmap();
+  std::memcpy(param.data(), holder.as<const void*>(), param.byte_size());
+}
+
+void OpenvinoExecutable::CollectCalibrationRanges(
+    InferenceEngine::InferRequest* request) {
+  for (const auto& it : calibration_tensors_) {
+    auto blob = InferenceEngine::as<InferenceEngine::MemoryBlob>(
+        request->GetBlob(it.first));
+    if (!blob || blob->getTensorDesc().getPrecision() !=
+                     InferenceEngine::Precision::FP32) {
+      continue;
+    }
+    auto holder = blob->rmap();
+    calibrator_resource_->calibrator_->Update(
+        it.second, holder.as<const float*>(), blob->size());
+  }
+}
+
 InferenceEngine::Blob::Ptr OpenvinoExecutable::ParameterToBlobPtr(
     const Parameter& input, const InferenceEngine::TensorDesc& in_desc) {
   const DataType& date_type = input.data_type();
@@ -84,6 +283,11 @@ InferenceEngine::Blob::Ptr OpenvinoExecutable::ParameterToBlobPtr(
   } else if (date_type == DataType::kDouble) {
     return InferenceEngine::make_shared_blob<double>(in_desc,
                                                      input.data<double>());
+  } else if (date_type == DataType::kFloat16 ||
+             date_type == DataType::kBFloat16) {
+    // half precision blobs are stored as int16
+    return InferenceEngine::make_shared_blob<int16_t>(in_desc,
+                                                      input.data<int16_t>());
   } else if (date_type == DataType::kInt8) {
     return InferenceEngine::make_shared_blob<int8_t>(in_desc,
                                                      input.data<int8_t>());
@@ -17,9 +17,15 @@ limitations under the License.
 #define ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_EXECUTABLE_H_
 
 #include <inference_engine.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "oneflow_xrt/compiler/executable.h"
 #include "oneflow_xrt/compiler/openvino/inference_engine_data_desc.h"
+#include "oneflow_xrt/compiler/openvino/openvino_int8_calibrator.h"
 #include "oneflow_xrt/compiler/parameter.h"
 
 namespace oneflow {
@@ -28,24 +34,118 @@ namespace openvino {
 
 class OpenvinoExecutable : public Executable {
  public:
+  // version of the weight folded into the network
+  struct WeightVersion {
+    // index of the entry params
+    int param_idx;
+    const void* data;
+    // the full contents are hashed on every run only if the caller opts in
+    // by ONEFLOW_XRT_OPENVINO_CHECK_FOLDED_WEIGHTS, otherwise the constants
+    // modified in place are not detected. The trainable variables are never
+    // folded, so the training does not depend on it
+    bool check_contents;
+    uint64_t fingerprint;
+  };
+
+  // the network is compiled for the max batch size, and runs the smaller
+  // batches by setting the batch size of the infer requests
+  struct DynamicBatch {
+    // dynamic batch is disabled if it's not positive
+    int64_t max_batch_size = -1;
+    // shapes of the entry params which the network is compiled for
+    std::vector<Shape> entry_shapes;
+    // whether the first dimension of the entry param is the batch
+    std::vector<bool> batched_entries;
+  };
+
   OpenvinoExecutable(
+      const std::string& name,
       std::unique_ptr<InferenceEngine::ExecutableNetwork> network,
-      const std::unordered_map<std::string, int>& in_out_to_param_idx)
-      : Executable("", XrtEngine::OPENVINO),
-        executable_network_(std::move(network)),
-        in_out_to_param_idx_(in_out_to_param_idx) {}
+      const std::unordered_map<std::string, int>& in_out_to_param_idx,
+      bool throughput_mode = false,
+      OpenvinoInt8CalibratorResource* calibrator_resource = nullptr,
+      const std::unordered_map<std::string, std::string>&
+          calibration_tensors = {},
+      const std::vector<WeightVersion>& weight_versions = {},
+      const DynamicBatch& dynamic_batch = DynamicBatch());
   virtual ~OpenvinoExecutable() = default;
 
   bool Run(const std::vector<Parameter>& inputs,
            const ExecutableRunOptions& run_options,
+           std::vector<Parameter>* results,
            bool block_until_done = true) override;
 
+  bool IsOutdated(const std::vector<Parameter>& inputs) const override;
+
+  bool IsCompatible(const std::vector<Parameter>& inputs) const override;
+
   InferenceEngine::Blob::Ptr ParameterToBlobPtr(
       const Parameter& input, const InferenceEngine::TensorDesc& in_desc);
 
+ private:
+  struct BlobBinding {
+    std::string name;
+    // index of the entry or return params
+    int param_idx;
+    // the blob of the batch is owned by the infer request, and the data is
+    // copied since its size is the max batch size
+    bool batched;
+  };
+
+  // infer request with the data pointers that have been bound to its blobs
+  struct InferRequestSlot {
+    InferenceEngine::InferRequest::Ptr request;
+    std::vector<void*> input_data;
+    std::vector<void*> output_data;
+  };
+
+  void InitTensorDescs(const std::vector<Parameter>& inputs,
+                       const std::vector<Parameter>& outputs);
+
+  std::unique_ptr<InferRequestSlot> AcquireInferRequest();
+  void ReleaseInferRequest(std::unique_ptr<InferRequestSlot> slot);
+
+  void BindBlob(InferenceEngine::InferRequest* request,
+                const BlobBinding& binding,
+                const InferenceEngine::TensorDesc& desc,
+                const Parameter& param, void** bound_data);
+
+  void CollectCalibrationRanges(InferenceEngine::InferRequest* request);
+
+  void CopyToBlob(InferenceEngine::InferRequest* request,
+                  const BlobBinding& binding, const Parameter& param);
+  void CopyFromBlob(InferenceEngine::InferRequest* request,
+                    const BlobBinding& binding, const Parameter& param);
+
  private:
   std::unique_ptr<InferenceEngine::ExecutableNetwork> executable_network_;
   std::unordered_map<std::string, int> in_out_to_param_idx_;
+  // run the infer requests asynchronously on the multiple streams of the
+  // network, so that the concurrent callers will not block each other
+  bool throughput_mode_;
+
+  // collect the activation ranges into the calibrator while running in the
+  // int8 calibration mode. `calibration_tensors_` maps the blob names to
+  // the tensor names in the calibration table
+  OpenvinoInt8CalibratorResource* calibrator_resource_;
+  std::unordered_map<std::string, std::string> calibration_tensors_;
+
+  std::vector<WeightVersion> weight_versions_;
+
+  DynamicBatch dynamic_batch_;
+
+  std::vector<BlobBinding> input_bindings_;
+  std::vector<BlobBinding> output_bindings_;
+  // tensor descs are the same for all runs since the executable is compiled
+  // for the specified entry params
+  std::once_flag tensor_descs_flag_;
+  std::vector<InferenceEngine::TensorDesc> input_descs_;
+  std::vector<InferenceEngine::TensorDesc> output_descs_;
+
+  // the idle infer requests, and a new one is created if all of them are
+  // in use by the concurrent callers
+  std::mutex requests_mutex_;
+  std::vector<std::unique_ptr<InferRequestSlot>> idle_requests_;
 };
 
 }  // namespace openvino
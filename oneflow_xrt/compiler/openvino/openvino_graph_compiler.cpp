@@ -15,7 +15,15 @@ limitations under the License.
 */
 #include "oneflow_xrt/compiler/openvino/openvino_graph_compiler.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include "absl/strings/str_cat.h"
+#include "oneflow_xrt/common/env.h"
+#include "oneflow_xrt/common/fingerprint.h"
+#include "oneflow_xrt/compiler/openvino/openvino_core.h"
 #include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+#include "oneflow_xrt/int8_calibration/calibration_mode.h"
 
 namespace oneflow {
 namespace xrt {
@@ -60,6 +68,9 @@ void OpenvinoGraphCompiler::SetupKernelContextParam(
       const std::string& k = arg.meta_data().consume_key;
       input_size++;
       input_output_args.emplace(k, arg);
+      if (edge->start()->IsEntryNode() && edge->start()->trainable()) {
+        context_param->variables.insert(arg);
+      }
       // when arg is graph input, operands_ maybe not hold it
       if (operands_.count(arg) <= 0) {
         continue;
@@ -79,6 +90,211 @@ void OpenvinoGraphCompiler::SetupKernelContextParam(
   context_param->arguments = std::move(input_output_args);
   context_param->inputs = std::move(input_ops);
   context_param->input_size = input_size;
+  context_param->share_weights = options_.share_weights();
+}
+
+uint64_t OpenvinoGraphCompiler::NetworkFingerprint(
+    const std::vector<Parameter>& entry_params,
+    const std::vector<Parameter>& return_params,
+    const std::map<std::string, std::string>& config) {
+  std::string key =
+      absl::StrCat(InferenceEngine::GetInferenceEngineVersion()->buildNumber);
+  for (const auto& param : entry_params) {
+    absl::StrAppend(&key, ";", param.name(), ":", param.shape().ToString(),
+                    ":", param.data_type());
+  }
+  for (const auto& param : return_params) {
+    absl::StrAppend(&key, ";", param.name(), ":", param.shape().ToString(),
+                    ":", param.data_type());
+  }
+  for (const auto& it : config) {
+    absl::StrAppend(&key, ";", it.first, "=", it.second);
+  }
+  return FingerprintCat64(fingerprint_, Fingerprint64(key));
+}
+
+// the inputs of convolutions and matmuls which run in int8 if quantized
+static std::vector<ngraph::Input<ngraph::Node>> QuantizableInputs(
+    const ngraph::Function& function) {
+  std::vector<ngraph::Input<ngraph::Node>> inputs;
+  for (const auto& node : function.get_ordered_ops()) {
+    if (ngraph::is_type<ngraph::op::v1::Convolution>(node) ||
+        ngraph::is_type<ngraph::op::v1::GroupConvolution>(node) ||
+        ngraph::is_type<ngraph::op::v0::MatMul>(node)) {
+      inputs.push_back(node->input(0));
+      inputs.push_back(node->input(1));
+    }
+  }
+  return inputs;
+}
+
+// return the weight constant, which maybe reshaped for group convolution
+static std::shared_ptr<ngraph::op::Constant> WeightConstant(
+    ngraph::Input<ngraph::Node>* input) {
+  auto node = input->get_source_output().get_node_shared_ptr();
+  if (ngraph::is_type<ngraph::op::v1::Reshape>(node)) {
+    auto weight = ngraph::as_type_ptr<ngraph::op::Constant>(
+        node->input_value(0).get_node_shared_ptr());
+    if (weight) {
+      *input = node->input(0);
+    }
+    return weight;
+  }
+  return ngraph::as_type_ptr<ngraph::op::Constant>(node);
+}
+
+static std::shared_ptr<ngraph::Node> MakeFakeQuantize(
+    const ngraph::Output<ngraph::Node>& source, float min, float max,
+    size_t levels) {
+  auto low = ngraph::op::Constant::create(ngraph::element::f32,
+                                          ngraph::Shape{}, {min});
+  auto high = ngraph::op::Constant::create(ngraph::element::f32,
+                                           ngraph::Shape{}, {max});
+  return std::make_shared<ngraph::op::v0::FakeQuantize>(source, low, high, low,
+                                                        high, levels);
+}
+
+std::unordered_map<const ngraph::Node*, std::string>
+OpenvinoGraphCompiler::TensorNames() const {
+  std::unordered_map<const ngraph::Node*, std::string> tensor_names;
+  for (const auto& it : operands_) {
+    tensor_names.emplace(it.second.get(), it.first.name());
+  }
+  return tensor_names;
+}
+
+void OpenvinoGraphCompiler::QuantizeFunction(
+    const ngraph::Function& function,
+    const OpenvinoInt8Calibrator& calibrator) {
+  const auto& tensor_names = TensorNames();
+  // the activation maybe consumed by several nodes
+  std::map<ngraph::Output<ngraph::Node>, std::shared_ptr<ngraph::Node>>
+      fake_quantizes;
+  for (auto input : QuantizableInputs(function)) {
+    if (input.get_element_type() != ngraph::element::f32) {
+      continue;
+    }
+    if (auto weight = WeightConstant(&input)) {
+      // symmetric per-tensor quantization for the weight
+      float range = 0.f;
+      for (float v : weight->cast_vector<float>()) {
+        range = std::max(range, std::abs(v));
+      }
+      if (range > 0.f) {
+        input.replace_source_output(
+            MakeFakeQuantize(weight, -range, range, 255));
+      }
+      continue;
+    }
+    const auto& source = input.get_source_output();
+    auto it = fake_quantizes.find(source);
+    if (it == fake_quantizes.end()) {
+      float min = 0.f, max = 0.f;
+      const auto& name = tensor_names.find(source.get_node());
+      if (name == tensor_names.end() ||
+          !calibrator.Lookup(name->second, &min, &max) || min >= max) {
+        VLOG(2) << "Skip quantizing the input of "
+                << input.get_node()->get_friendly_name()
+                << " since it has not been calibrated";
+        continue;
+      }
+      it = fake_quantizes
+               .emplace(source, MakeFakeQuantize(source, min, max, 256))
+               .first;
+    }
+    input.replace_source_output(it->second);
+  }
+}
+
+void OpenvinoGraphCompiler::AddCalibrationResults(
+    const ngraph::Function& function,
+    const std::unordered_map<std::string, int>& in_out_to_param_idx,
+    ngraph::ResultVector* result_nodes,
+    std::unordered_map<std::string, std::string>* calibration_tensors) {
+  const auto& tensor_names = TensorNames();
+  for (auto input : QuantizableInputs(function)) {
+    if (input.get_element_type() != ngraph::element::f32 ||
+        WeightConstant(&input)) {
+      continue;
+    }
+    auto node = input.get_source_output().get_node_shared_ptr();
+    const auto& name = tensor_names.find(node.get());
+    if (node->get_output_size() != 1 || name == tensor_names.end()) {
+      continue;
+    }
+    // the blob is named by the friendly name of its producer
+    const std::string& blob_name = node->get_friendly_name();
+    if (!calibration_tensors->emplace(blob_name, name->second).second) {
+      continue;
+    }
+    // the entry params and the results can be read from the infer request
+    // directly
+    if (in_out_to_param_idx.count(blob_name) == 0) {
+      result_nodes->push_back(std::make_shared<ngraph::op::Result>(node));
+    }
+  }
+}
+
+bool OpenvinoGraphCompiler::ReshapeToMaxBatch(
+    const std::vector<Parameter>& entry_params,
+    const std::vector<Parameter>& return_params,
+    const std::unordered_map<std::string, int>& in_out_to_param_idx,
+    const std::unordered_set<std::string>& weight_inputs,
+    InferenceEngine::CNNNetwork* network,
+    OpenvinoExecutable::DynamicBatch* dynamic_batch) {
+  const int64_t max_batch_size = options_.max_batch_size();
+  const auto static_shapes = network->getInputShapes();
+  auto batch_shapes = static_shapes;
+  std::vector<bool> batched_entries(entry_params.size(), false);
+  // the first dimension of all the inputs except the weights and all the
+  // outputs should be the same batch
+  int64_t batch_size = -1;
+  for (auto& it : batch_shapes) {
+    if (weight_inputs.count(it.first) > 0) {
+      continue;
+    }
+    const int param_idx = in_out_to_param_idx.at(it.first);
+    const Shape& shape = entry_params[param_idx].shape();
+    if (shape.NumAxes() == 0 ||
+        (batch_size > 0 && shape.At(0) != batch_size)) {
+      return false;
+    }
+    batch_size = shape.At(0);
+    it.second[0] = max_batch_size;
+    batched_entries[param_idx] = true;
+  }
+  if (batch_size <= 0 || batch_size > max_batch_size) {
+    return false;
+  }
+  for (const auto& param : return_params) {
+    if (param.shape().NumAxes() == 0 || param.shape().At(0) != batch_size) {
+      return false;
+    }
+  }
+
+  // the network maybe not be reshaped since some ops are specialized for
+  // the batch size
+  try {
+    network->reshape(batch_shapes);
+    for (const auto& output : network->getOutputsInfo()) {
+      const auto& dims = output.second->getTensorDesc().getDims();
+      if (static_cast<int64_t>(dims[0]) != max_batch_size) {
+        network->reshape(static_shapes);
+        return false;
+      }
+    }
+  } catch (const std::exception& e) {
+    VLOG(2) << "failed to reshape network " << name_ << " to batch size "
+            << max_batch_size << " (" << e.what() << ")";
+    network->reshape(static_shapes);
+    return false;
+  }
+  dynamic_batch->max_batch_size = max_batch_size;
+  dynamic_batch->batched_entries = std::move(batched_entries);
+  for (const auto& param : entry_params) {
+    dynamic_batch->entry_shapes.push_back(param.shape());
+  }
+  return true;
 }
 
 std::shared_ptr<Executable> OpenvinoGraphCompiler::Compile(
@@ -88,6 +304,10 @@ std::shared_ptr<Executable> OpenvinoGraphCompiler::Compile(
   // openvino input output name to entry and return param index
   std::unordered_map<std::string, int> in_out_to_param_idx;
   ngraph::ParameterVector parameter_nodes;
+  // entry param indices of the weights folded as constants
+  std::vector<int> folded_weights;
+  // names of the network inputs which are the shared weights
+  std::unordered_set<std::string> weight_inputs;
   std::unordered_map<Argument, Parameter> entry_params_map;
   std::unordered_map<Argument, int> entry_params_index_map;
   PopulateEntryParams(entry_params, entry_params_map, entry_params_index_map);
@@ -116,10 +336,14 @@ std::shared_ptr<Executable> OpenvinoGraphCompiler::Compile(
           entry_params_index_map[it->first];
       parameter_nodes.push_back(
           ngraph::as_type_ptr<ngraph::op::Parameter>(it->second));
+      if (op_context.shared_weights().count(it->first) > 0) {
+        weight_inputs.insert(it->second->get_friendly_name());
+      }
     }
     const auto& graph_weight = op_context.graph_weight();
     for (auto it = graph_weight.begin(); it != graph_weight.end(); ++it) {
       operands_[it->first] = it->second;
+      folded_weights.push_back(entry_params_index_map[it->first]);
     }
     // always insert the new output into `operands_`
     const auto& outputs = op_context.outputs();
@@ -138,8 +362,35 @@ std::shared_ptr<Executable> OpenvinoGraphCompiler::Compile(
 
   std::shared_ptr<ngraph::Function> ngraph_func =
       std::make_shared<ngraph::Function>(result_nodes, parameter_nodes);
+
+  std::string calibration_table;
+  OpenvinoInt8CalibratorResource* calibrator_resource = nullptr;
+  std::unordered_map<std::string, std::string> calibration_tensors;
+  if (options_.use_int8()) {
+    if (!options_.int8_calibration().empty()) {
+      calibration_table =
+          LoadInt8CalibrationTable(options_.int8_calibration(), name_);
+      QuantizeFunction(*ngraph_func, OpenvinoInt8Calibrator(calibration_table));
+    } else {
+      CHECK(PTQCalibrationMode::Enabled())
+          << "A offline calibration table should be provided or enable "
+             "calibration mode to generate one online";
+      calibrator_resource =
+          OpenvinoInt8CalibratorResource::LookupOrCreate(name_);
+      {
+        std::lock_guard<std::mutex> lock(calibrator_resource->mutex_);
+        if (!calibrator_resource->calibrator_) {
+          calibrator_resource->calibrator_.reset(new OpenvinoInt8Calibrator);
+        }
+      }
+      AddCalibrationResults(*ngraph_func, in_out_to_param_idx, &result_nodes,
+                            &calibration_tensors);
+    }
+    ngraph_func =
+        std::make_shared<ngraph::Function>(result_nodes, parameter_nodes);
+  }
+
   InferenceEngine::CNNNetwork cnn_network(ngraph_func);
-  InferenceEngine::Core ie;
   InferenceEngine::InputsDataMap input_info(cnn_network.getInputsInfo());
   for (auto& input : input_info) {
     auto it = in_out_to_param_idx.find(input.first);
@@ -150,11 +401,77 @@ std::shared_ptr<Executable> OpenvinoGraphCompiler::Compile(
     input.second->setPrecision(data_desc.precision());
     input.second->setLayout(data_desc.layout());
   }
-  auto executable_network =
-      std::make_unique<InferenceEngine::ExecutableNetwork>(
-          ie.LoadNetwork(cnn_network, "CPU"));
-  return std::make_shared<OpenvinoExecutable>(std::move(executable_network),
-                                              in_out_to_param_idx);
+  InferenceEngine::OutputsDataMap output_info(cnn_network.getOutputsInfo());
+  for (auto& output : output_info) {
+    auto it = in_out_to_param_idx.find(output.first);
+    if (it == in_out_to_param_idx.end()) {
+      continue;
+    }
+    InferenceEngineDataDesc data_desc(return_params[it->second].shape(),
+                                      return_params[it->second].data_type());
+    output.second->setPrecision(data_desc.precision());
+  }
+
+  // the network for calibration is never cached since it has extra outputs,
+  // and the quantized one is identified with its calibration table
+  std::string engine_cache_dir =
+      calibrator_resource ? "" : options_.engine_cache_dir();
+  uint64_t weights_fingerprint = Fingerprint64(calibration_table);
+  bool check_weight_contents =
+      EnvToBool(ONEFLOW_XRT_OPENVINO_CHECK_FOLDED_WEIGHTS, false);
+  std::vector<OpenvinoExecutable::WeightVersion> weight_versions;
+  for (int param_idx : folded_weights) {
+    const Parameter& weight = entry_params[param_idx];
+    uint64_t fingerprint = 0;
+    if (check_weight_contents || !engine_cache_dir.empty()) {
+      fingerprint = Fingerprint64(weight.data<char>(), weight.byte_size());
+    }
+    weight_versions.push_back(OpenvinoExecutable::WeightVersion{
+        param_idx, weight.data(), check_weight_contents, fingerprint});
+    // the folded weights are a part of the cached network
+    if (!engine_cache_dir.empty()) {
+      weights_fingerprint = FingerprintCat64(weights_fingerprint, fingerprint);
+    }
+  }
+
+  // the network for the max batch size runs all the smaller batches, and
+  // the collected ranges will be wrong if the batch is padded
+  OpenvinoExecutable::DynamicBatch dynamic_batch;
+  const auto static_shapes = cnn_network.getInputShapes();
+  if (options_.max_batch_size() > 1 && !calibrator_resource) {
+    ReshapeToMaxBatch(entry_params, return_params, in_out_to_param_idx,
+                      weight_inputs, &cnn_network, &dynamic_batch);
+  }
+  auto LoadExecutableNetwork = [&]() {
+    auto config = MakeLoadNetworkConfig(options_);
+    if (dynamic_batch.max_batch_size > 0) {
+      config[CONFIG_KEY(DYN_BATCH_ENABLED)] = CONFIG_VALUE(YES);
+    }
+    uint64_t network_fingerprint = FingerprintCat64(
+        NetworkFingerprint(entry_params, return_params, config),
+        weights_fingerprint);
+    return std::make_unique<InferenceEngine::ExecutableNetwork>(LoadNetwork(
+        cnn_network, config, engine_cache_dir, network_fingerprint));
+  };
+  std::unique_ptr<InferenceEngine::ExecutableNetwork> executable_network;
+  try {
+    executable_network = LoadExecutableNetwork();
+  } catch (const std::exception& e) {
+    if (dynamic_batch.max_batch_size <= 0) {
+      throw;
+    }
+    VLOG(2) << "failed to load network " << name_ << " with dynamic batch ("
+            << e.what() << "), it will be loaded with the static shapes";
+    cnn_network.reshape(static_shapes);
+    dynamic_batch = OpenvinoExecutable::DynamicBatch();
+    executable_network = LoadExecutableNetwork();
+  }
+
+  bool throughput_mode = (options_.num_streams() != 1);
+  return std::make_shared<OpenvinoExecutable>(
+      name_, std::move(executable_network), in_out_to_param_idx,
+      throughput_mode, calibrator_resource, calibration_tensors,
+      weight_versions, dynamic_batch);
 }
 
 REGISTER_GRAPH_COMPILER(XrtEngine::OPENVINO, OpenvinoGraphCompiler);
@@ -16,9 +16,15 @@ limitations under the License.
 #ifndef ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_GRAPH_COMPILER_H_
 #define ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_GRAPH_COMPILER_H_
 
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "oneflow_xrt/compiler/graph_compiler.h"
 #include "oneflow_xrt/compiler/openvino/ngraph_shape.h"
 #include "oneflow_xrt/compiler/openvino/openvino_executable.h"
+#include "oneflow_xrt/compiler/openvino/openvino_int8_calibrator.h"
 #include "oneflow_xrt/compiler/openvino/ops/op_context.h"
 
 namespace oneflow {
@@ -48,6 +54,38 @@ class OpenvinoGraphCompiler : public GraphCompiler::Impl {
 
   Argument ArgFromParameter(const Parameter& param);
 
+  // identify the compiled network by the function, params and load config
+  uint64_t NetworkFingerprint(
+      const std::vector<Parameter>& entry_params,
+      const std::vector<Parameter>& return_params,
+      const std::map<std::string, std::string>& config);
+
+  // names of the tensors in the calibration table
+  std::unordered_map<const ngraph::Node*, std::string> TensorNames() const;
+
+  // insert FakeQuantize nodes for the inputs of convolutions and matmuls
+  void QuantizeFunction(const ngraph::Function& function,
+                        const OpenvinoInt8Calibrator& calibrator);
+
+  // make the activations of convolutions and matmuls be outputs of the
+  // network, so that their ranges can be collected after each run
+  void AddCalibrationResults(
+      const ngraph::Function& function,
+      const std::unordered_map<std::string, int>& in_out_to_param_idx,
+      ngraph::ResultVector* result_nodes,
+      std::unordered_map<std::string, std::string>* calibration_tensors);
+
+  // reshape the network to the max batch size if the first dimension of
+  // the inputs and outputs is the batch, so that it runs all the smaller
+  // batches by dynamic batch. Return false if it can not be reshaped
+  bool ReshapeToMaxBatch(
+      const std::vector<Parameter>& entry_params,
+      const std::vector<Parameter>& return_params,
+      const std::unordered_map<std::string, int>& in_out_to_param_idx,
+      const std::unordered_set<std::string>& weight_inputs,
+      InferenceEngine::CNNNetwork* network,
+      OpenvinoExecutable::DynamicBatch* dynamic_batch);
+
  private:
   std::unordered_map<std::string, Argument> arguments_;
   std::unordered_map<Argument, std::shared_ptr<ngraph::Node>> operands_;
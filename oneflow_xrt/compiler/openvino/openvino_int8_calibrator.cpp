@@ -0,0 +1,123 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/openvino/openvino_int8_calibrator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+OpenvinoInt8Calibrator::OpenvinoInt8Calibrator(
+    const std::string& calibration_table) {
+  std::istringstream iss(calibration_table);
+  std::string name;
+  float min = 0, max = 0;
+  while (iss >> name >> min >> max) {
+    ranges_[name] = std::make_pair(min, max);
+  }
+}
+
+void OpenvinoInt8Calibrator::Update(const std::string& name, const float* data,
+                                    int64_t size) {
+  if (size <= 0) {
+    return;
+  }
+  const auto& minmax = std::minmax_element(data, data + size);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ranges_.find(name);
+  if (it == ranges_.end()) {
+    ranges_.emplace(name, std::make_pair(*minmax.first, *minmax.second));
+  } else {
+    it->second.first = std::min(it->second.first, *minmax.first);
+    it->second.second = std::max(it->second.second, *minmax.second);
+  }
+}
+
+bool OpenvinoInt8Calibrator::Lookup(const std::string& name, float* min,
+                                    float* max) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto& it = ranges_.find(name);
+  if (it == ranges_.end()) {
+    return false;
+  }
+  *min = it->second.first;
+  *max = it->second.second;
+  return true;
+}
+
+std::string OpenvinoInt8Calibrator::GetCalibrationTableAsString() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream oss;
+  oss.precision(9);
+  for (const auto& it : ranges_) {
+    oss << it.first << " " << it.second.first << " " << it.second.second
+        << "\n";
+  }
+  return oss.str();
+}
+
+static std::unordered_map<std::string, OpenvinoInt8CalibratorResource*>
+    resources;
+
+/* static */ OpenvinoInt8CalibratorResource*
+OpenvinoInt8CalibratorResource::LookupOrCreate(const std::string& name) {
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = resources.find(name);
+  if (it == resources.end()) {
+    it = resources.emplace(name, new OpenvinoInt8CalibratorResource).first;
+    Int8CalibratorResource::Record(name, it->second);
+  }
+  return it->second;
+}
+
+void OpenvinoInt8CalibratorResource::WaitAndSetDone() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  done_ = true;
+}
+
+bool OpenvinoInt8CalibratorResource::IsDone() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return done_;
+}
+
+std::string OpenvinoInt8CalibratorResource::GetCalibrationTableAsString()
+    const {
+  CHECK(IsDone()) << "Calibration table maybe has not been generated "
+                  << "since the calibrator has not been done";
+  return calibrator_->GetCalibrationTableAsString();
+}
+
+std::string LoadInt8CalibrationTable(const std::string& calibration_path,
+                                     const std::string& name) {
+  std::string calib_restore_path(absl::StrCat(calibration_path, "/", name));
+  std::ifstream infile(calib_restore_path, std::ios::in);
+  CHECK(infile.good()) << "Could not open calibration file: "
+                       << calib_restore_path;
+  std::stringstream buffer;
+  buffer << infile.rdbuf();
+  return buffer.str();
+}
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
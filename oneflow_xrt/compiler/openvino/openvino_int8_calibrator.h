@@ -0,0 +1,81 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_INT8_CALIBRATOR_H_
+#define ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_INT8_CALIBRATOR_H_
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "oneflow_xrt/int8_calibration/calibration.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+// Per-tensor ranges of the activations for int8 post-training quantization.
+// The calibration table has a line "<tensor name> <min> <max>" for each
+// tensor
+class OpenvinoInt8Calibrator {
+ public:
+  // Construct a calibrator for future calibration.
+  OpenvinoInt8Calibrator() = default;
+
+  // Construct a finalized calibrator from the calibration table.
+  explicit OpenvinoInt8Calibrator(const std::string& calibration_table);
+
+  // Merge the range of `data` into the range of tensor `name`.
+  void Update(const std::string& name, const float* data, int64_t size);
+
+  // Return false if the range of tensor `name` has not been calibrated.
+  bool Lookup(const std::string& name, float* min, float* max) const;
+
+  std::string GetCalibrationTableAsString() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::pair<float, float>> ranges_;
+};
+
+struct OpenvinoInt8CalibratorResource : public Int8CalibratorResource {
+ public:
+  static OpenvinoInt8CalibratorResource* LookupOrCreate(
+      const std::string& name);
+
+  // the ranges are collected synchronously after each execution, so there is
+  // nothing to wait for
+  void WaitAndSetDone() override;
+  bool IsDone() const override;
+  std::string GetCalibrationTableAsString() const override;
+
+  // Individual mutex
+  mutable std::mutex mutex_;
+  bool done_ = false;
+
+  std::shared_ptr<OpenvinoInt8Calibrator> calibrator_;
+};
+
+// load the calibration table of the executable `name` in the directory
+std::string LoadInt8CalibrationTable(const std::string& calibration_path,
+                                     const std::string& name);
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMPILER_OPENVINO_OPENVINO_INT8_CALIBRATOR_H_
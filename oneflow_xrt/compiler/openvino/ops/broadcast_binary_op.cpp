@@ -0,0 +1,72 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <ngraph/op/add.hpp>
+#include <ngraph/op/divide.hpp>
+#include <ngraph/op/maximum.hpp>
+#include <ngraph/op/minimum.hpp>
+#include <ngraph/op/multiply.hpp>
+#include <ngraph/op/power.hpp>
+#include <ngraph/op/subtract.hpp>
+
+#include "oneflow_xrt/compiler/openvino/ops/op_context.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+// the binary ops broadcast the inputs by numpy style
+template <typename BinaryOp>
+class BcastBinaryOp : public OpenvinoOpKernel {
+ public:
+  void Compile(OpenvinoOpContext* ctx) override {
+    std::shared_ptr<ngraph::Node> ngraph_node =
+        std::make_shared<BinaryOp>(ctx->Input("x_0"), ctx->Input("y_0"));
+    ngraph_node->set_friendly_name(ctx->op_name().c_str());
+    ctx->SetOutput("z_0", ngraph_node);
+  }
+};
+
+REGISTER_OPENVINO_OP_KERNEL(broadcast_add, BcastBinaryOp<ngraph::op::v1::Add>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(broadcast_sub,
+                            BcastBinaryOp<ngraph::op::v1::Subtract>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(broadcast_mul,
+                            BcastBinaryOp<ngraph::op::v1::Multiply>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(broadcast_div,
+                            BcastBinaryOp<ngraph::op::v1::Divide>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(broadcast_minimum,
+                            BcastBinaryOp<ngraph::op::v1::Minimum>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(broadcast_maximum,
+                            BcastBinaryOp<ngraph::op::v1::Maximum>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(broadcast_pow, BcastBinaryOp<ngraph::op::v1::Power>)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
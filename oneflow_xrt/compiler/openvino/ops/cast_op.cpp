@@ -0,0 +1,47 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <ngraph/op/convert.hpp>
+
+#include "oneflow_xrt/compiler/openvino/ngraph_shape.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_context.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+class CastOp : public OpenvinoOpKernel {
+ public:
+  void Compile(OpenvinoOpContext* ctx) override {
+    DataType dest_dtype = ctx->Attr<DataType>("dtype");
+    std::shared_ptr<ngraph::Node> input = ctx->Input("in_0");
+    if (ctx->InputType("in_0") == dest_dtype) {
+      ctx->SetOutput("out_0", input);
+      return;
+    }
+    std::shared_ptr<ngraph::Node> ngraph_node =
+        std::make_shared<ngraph::op::v0::Convert>(
+            input, DataTypeToNgraphDataType(dest_dtype));
+    ngraph_node->set_friendly_name(ctx->op_name().c_str());
+    ctx->SetOutput("out_0", ngraph_node);
+  }
+};
+
+REGISTER_OPENVINO_OP_KERNEL(cast, CastOp).EnableTrainPhase().Finalize();
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,51 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <ngraph/op/constant.hpp>
+#include <ngraph/op/gather.hpp>
+
+#include "oneflow_xrt/compiler/openvino/ops/op_context.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+class GatherOp : public OpenvinoOpKernel {
+ public:
+  void Compile(OpenvinoOpContext* ctx) override {
+    Shape in_shape = ctx->InputShape("in_0");
+    Shape indices_shape = ctx->InputShape("indices_0");
+    CHECK_GT(in_shape.NumAxes(), 0);
+    CHECK_GT(indices_shape.NumAxes(), 0);
+
+    int64_t axis = ctx->Attr<int64_t>("axis");
+    std::shared_ptr<ngraph::Node> axis_node =
+        std::make_shared<ngraph::op::Constant>(
+            ngraph::element::i64, ngraph::Shape({}),
+            std::vector<int64_t>{axis});
+    std::shared_ptr<ngraph::Node> ngraph_node =
+        std::make_shared<ngraph::op::v1::Gather>(
+            ctx->Input("in_0"), ctx->Input("indices_0"), axis_node);
+    ngraph_node->set_friendly_name(ctx->op_name().c_str());
+    ctx->SetOutput("out_0", ngraph_node);
+  }
+};
+
+REGISTER_OPENVINO_OP_KERNEL(gather, GatherOp).EnableTrainPhase().Finalize();
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,117 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <ngraph/op/add.hpp>
+#include <ngraph/op/constant.hpp>
+#include <ngraph/op/divide.hpp>
+#include <ngraph/op/multiply.hpp>
+#include <ngraph/op/mvn.hpp>
+#include <ngraph/op/reduce_mean.hpp>
+#include <ngraph/op/reshape.hpp>
+#include <ngraph/op/sqrt.hpp>
+#include <ngraph/op/squared_difference.hpp>
+
+#include "oneflow_xrt/compiler/openvino/ngraph_shape.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_context.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+class LayerNormOp : public OpenvinoOpKernel {
+ public:
+  void Compile(OpenvinoOpContext* ctx) override;
+};
+
+void LayerNormOp::Compile(OpenvinoOpContext* ctx) {
+  Shape in_shape = ctx->InputShape("x_0");
+  int begin_norm_axis = ctx->Attr<int64_t>("begin_norm_axis");
+  int begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+  CHECK_LT(begin_norm_axis, in_shape.NumAxes());
+  CHECK_LT(begin_params_axis, in_shape.NumAxes());
+  while (begin_norm_axis < 0) {
+    begin_norm_axis += in_shape.NumAxes();
+  }
+  while (begin_params_axis < 0) {
+    begin_params_axis += in_shape.NumAxes();
+  }
+  double epsilon = ctx->Attr<double>("epsilon");
+
+  std::vector<int64_t> axes;
+  for (int i = begin_norm_axis; i < in_shape.NumAxes(); ++i) {
+    axes.push_back(i);
+  }
+  std::shared_ptr<ngraph::Node> axes_node =
+      std::make_shared<ngraph::op::Constant>(
+          ngraph::element::i64, ngraph::Shape({axes.size()}), axes);
+
+  std::shared_ptr<ngraph::Node> input = ctx->Input("x_0");
+  // y = (x - mean) / sqrt(variance + epsilon)
+  std::shared_ptr<ngraph::Node> output = std::make_shared<ngraph::op::v6::MVN>(
+      input, axes_node, true /*normalize_variance*/, epsilon,
+      ngraph::op::MVNEpsMode::INSIDE_SQRT);
+
+  // the leading dimensions of gamma and beta are broadcasted by numpy style
+  Shape param_shape(DimVector(in_shape.dim_vec().begin() + begin_params_axis,
+                              in_shape.dim_vec().end()));
+  if (ctx->Attr<bool>("scale")) {
+    output = std::make_shared<ngraph::op::v1::Multiply>(
+        output, BatchAgnosticReshape(ctx->Input("gamma_0"), param_shape));
+  }
+  if (ctx->Attr<bool>("center")) {
+    output = std::make_shared<ngraph::op::v1::Add>(
+        output, BatchAgnosticReshape(ctx->Input("beta_0"), param_shape));
+  }
+  output->set_friendly_name(ctx->op_name().c_str());
+  ctx->SetOutput("y_0", output);
+
+  // the statistics are only computed if they are consumed
+  if (ctx->HasOutput("mean_0") || ctx->HasOutput("inv_variance_0")) {
+    std::shared_ptr<ngraph::Node> mean =
+        std::make_shared<ngraph::op::v1::ReduceMean>(input, axes_node,
+                                                     true /*keep_dims*/);
+    if (ctx->HasOutput("mean_0")) {
+      ctx->SetOutput("mean_0",
+                     BatchAgnosticReshape(mean, ctx->OutputShape("mean_0")));
+    }
+    if (ctx->HasOutput("inv_variance_0")) {
+      ngraph::element::Type data_type =
+          DataTypeToNgraphDataType(ctx->InputType("x_0"));
+      std::shared_ptr<ngraph::Node> variance =
+          std::make_shared<ngraph::op::v1::ReduceMean>(
+              std::make_shared<ngraph::op::v0::SquaredDifference>(input, mean),
+              axes_node, false /*keep_dims*/);
+      std::shared_ptr<ngraph::Node> inv_variance =
+          std::make_shared<ngraph::op::v1::Divide>(
+              ngraph::op::Constant::create(data_type, ngraph::Shape({}), {1.0}),
+              std::make_shared<ngraph::op::v0::Sqrt>(
+                  std::make_shared<ngraph::op::v1::Add>(
+                      variance, ngraph::op::Constant::create(
+                                    data_type, ngraph::Shape({}), {epsilon}))));
+      ctx->SetOutput("inv_variance_0",
+                     BatchAgnosticReshape(inv_variance,
+                                          ctx->OutputShape("inv_variance_0")));
+    }
+  }
+}
+
+REGISTER_OPENVINO_OP_KERNEL(layer_norm, LayerNormOp)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <ngraph/op/add.hpp>
 #include <ngraph/op/matmul.hpp>
 
 #include "oneflow_xrt/compiler/openvino/ops/op_context.h"
@@ -38,12 +39,20 @@ class MatMulOp : public OpenvinoOpKernel {
     std::shared_ptr<ngraph::Node> ngraph_node =
         std::make_shared<ngraph::op::v0::MatMul>(a, b, transpose_a,
                                                  transpose_b);
+    if (ctx->HasInput("_add_to_output_0")) {
+      ngraph_node = std::make_shared<ngraph::op::v1::Add>(
+          ngraph_node, ctx->Input("_add_to_output_0"));
+    }
     ngraph_node->set_friendly_name(ctx->op_name().c_str());
     ctx->SetOutput("out_0", ngraph_node);
   }
 };
 
 REGISTER_OPENVINO_OP_KERNEL(matmul, MatMulOp).EnableTrainPhase().Finalize();
+// the leading dimensions of batch matmul are broadcasted as batches
+REGISTER_OPENVINO_OP_KERNEL(batch_matmul, MatMulOp)
+    .EnableTrainPhase()
+    .Finalize();
 
 }  // namespace openvino
 }  // namespace xrt
@@ -38,6 +38,15 @@ std::shared_ptr<ngraph::Node> OpenvinoOpContext::Weight(
   return Weight(ArgumentFromKey(name));
 }
 
+// the input maybe an entry param which is not hold by `param_.inputs`
+bool OpenvinoOpContext::HasInput(const std::string& name) const {
+  return param_.arguments.count(name) > 0;
+}
+
+bool OpenvinoOpContext::HasOutput(const std::string& name) const {
+  return param_.arguments.count(name) > 0;
+}
+
 std::shared_ptr<ngraph::Node> OpenvinoOpContext::Input(const Argument& arg) {
   if (param_.inputs.count(arg) > 0) {
     return param_.inputs.at(arg);
@@ -61,6 +70,12 @@ std::shared_ptr<ngraph::Node> OpenvinoOpContext::Weight(const Argument& arg) {
   if (param_.inputs.count(arg) > 0) {
     return param_.inputs.at(arg);
   }
+  // the weight memory is bound to the infer requests without copy, and the
+  // variables are always bound since the training updates them in place
+  if (param_.share_weights || param_.variables.count(arg) > 0) {
+    shared_weights_.insert(arg);
+    return Input(arg);
+  }
   auto it = entry_params_map_.find(arg);
   CHECK(it != entry_params_map_.end());
   NgraphShape shape(it->second.shape(), it->second.data_type());
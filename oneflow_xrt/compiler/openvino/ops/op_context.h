@@ -19,6 +19,7 @@ limitations under the License.
 #include <inference_engine.hpp>
 #include <ngraph/function.hpp>
 #include <ngraph/node.hpp>
+#include <unordered_set>
 
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/common/shape.h"
@@ -43,6 +44,12 @@ class OpenvinoOpContext : public OpContext {
     int input_size;
 
     std::unordered_map<std::string, Argument> arguments;
+
+    // weights are the inputs of the network rather than constants if true
+    bool share_weights = false;
+    // the arguments of the trainable variables, which are always the inputs
+    // of the network
+    std::unordered_set<Argument> variables;
   };
 
   explicit OpenvinoOpContext(
@@ -52,6 +59,7 @@ class OpenvinoOpContext : public OpContext {
         param_(param),
         graph_inputs_(),
         graph_weight_(),
+        shared_weights_(),
         outputs_(),
         entry_params_map_(entry_params_map) {}
 
@@ -74,6 +82,9 @@ class OpenvinoOpContext : public OpContext {
 
   int num_inputs() const { return param_.input_size; }
 
+  bool HasInput(const std::string& name) const;
+  bool HasOutput(const std::string& name) const;
+
   // Return inputs as OpenvinoValues
   const std::unordered_map<Argument, std::shared_ptr<ngraph::Node>>&
   graph_inputs() const {
@@ -83,6 +94,10 @@ class OpenvinoOpContext : public OpContext {
   graph_weight() const {
     return graph_weight_;
   }
+  // the weights in `graph_inputs` if they are shared with the network
+  const std::unordered_set<Argument>& shared_weights() const {
+    return shared_weights_;
+  }
   // Return output as OpenvinoValues
   const std::unordered_map<Argument, std::shared_ptr<ngraph::Node>>& outputs()
       const {
@@ -112,6 +127,7 @@ class OpenvinoOpContext : public OpContext {
   // Output operands
   std::unordered_map<Argument, std::shared_ptr<ngraph::Node>> graph_inputs_;
   std::unordered_map<Argument, std::shared_ptr<ngraph::Node>> graph_weight_;
+  std::unordered_set<Argument> shared_weights_;
   std::unordered_map<Argument, std::shared_ptr<ngraph::Node>> outputs_;
 
   const std::unordered_map<Argument, Parameter>& entry_params_map_;
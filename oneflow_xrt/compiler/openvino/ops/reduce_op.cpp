@@ -0,0 +1,75 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <ngraph/op/constant.hpp>
+#include <ngraph/op/max.hpp>
+#include <ngraph/op/min.hpp>
+#include <ngraph/op/reduce_prod.hpp>
+#include <ngraph/op/reduce_sum.hpp>
+
+#include "oneflow_xrt/compiler/openvino/ops/op_context.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+template <typename ReduceOp>
+class ReduceOpKernel : public OpenvinoOpKernel {
+ public:
+  void Compile(OpenvinoOpContext* ctx) override {
+    std::vector<int32_t> axis = ctx->Attr<std::vector<int32_t>>("axis");
+    Shape in_shape = ctx->InputShape("input_tensor_0");
+    std::vector<int64_t> axes;
+    for (int i = 0; i < axis.size(); ++i) {
+      axes.push_back(axis[i] < 0 ? axis[i] + in_shape.NumAxes() : axis[i]);
+    }
+    // reduce all axes if axis is empty
+    if (axes.empty()) {
+      for (int i = 0; i < in_shape.NumAxes(); ++i) {
+        axes.push_back(i);
+      }
+    }
+    std::shared_ptr<ngraph::Node> axes_node =
+        std::make_shared<ngraph::op::Constant>(
+            ngraph::element::i64, ngraph::Shape({axes.size()}), axes);
+    bool keep_dims = ctx->Attr<bool>("keepdims");
+    std::shared_ptr<ngraph::Node> ngraph_node = std::make_shared<ReduceOp>(
+        ctx->Input("input_tensor_0"), axes_node, keep_dims);
+    ngraph_node->set_friendly_name(ctx->op_name().c_str());
+    ctx->SetOutput("output_tensor_0", ngraph_node);
+  }
+};
+
+REGISTER_OPENVINO_OP_KERNEL(reduce_sum,
+                            ReduceOpKernel<ngraph::op::v1::ReduceSum>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(reduce_prod,
+                            ReduceOpKernel<ngraph::op::v1::ReduceProd>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(reduce_max,
+                            ReduceOpKernel<ngraph::op::v1::ReduceMax>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(reduce_min,
+                            ReduceOpKernel<ngraph::op::v1::ReduceMin>)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include <ngraph/op/constant.hpp>
 #include <ngraph/op/reshape.hpp>
 
+#include "oneflow_xrt/compiler/openvino/ngraph_shape.h"
 #include "oneflow_xrt/compiler/openvino/ops/op_context.h"
 #include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
 
@@ -29,17 +30,9 @@ class ReshapeOp : public OpenvinoOpKernel {
     Shape in_shape = ctx->InputShape("in_0");
     Shape shape = ctx->OutputShape("out_0");
     CHECK_EQ(shape.Count(0), in_shape.Count(0));
-    std::vector<size_t> dim_vec;
-    for (int i = 0; i < shape.NumAxes(); ++i) {
-      dim_vec.push_back(shape.At(i));
-    }
-
-    std::shared_ptr<ngraph::Node> alpha_node =
-        std::make_shared<ngraph::op::Constant>(
-            ngraph::element::i32, ngraph::Shape({dim_vec.size()}), dim_vec);
+
     std::shared_ptr<ngraph::Node> ngraph_node =
-        std::make_shared<ngraph::op::v1::Reshape>(ctx->Input("in_0"),
-                                                  alpha_node, false);
+        BatchAgnosticReshape(ctx->Input("in_0"), shape);
     ngraph_node->set_friendly_name(ctx->op_name().c_str());
     ctx->SetOutput("out_0", ngraph_node);
   }
@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <ngraph/op/add.hpp>
+#include <ngraph/op/constant.hpp>
+#include <ngraph/op/divide.hpp>
+#include <ngraph/op/multiply.hpp>
+#include <ngraph/op/power.hpp>
+#include <ngraph/op/subtract.hpp>
+
+#include "oneflow_xrt/compiler/openvino/ngraph_shape.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_context.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+template <typename BinaryOp>
+class ScalarBinaryOp : public OpenvinoOpKernel {
+ public:
+  void Compile(OpenvinoOpContext* ctx) override {
+    std::shared_ptr<ngraph::Node> ngraph_node =
+        std::make_shared<BinaryOp>(ctx->Input("in_0"), Scalar(ctx));
+    ngraph_node->set_friendly_name(ctx->op_name().c_str());
+    ctx->SetOutput("out_0", ngraph_node);
+  }
+
+  std::shared_ptr<ngraph::Node> Scalar(OpenvinoOpContext* ctx) const {
+    ngraph::element::Type data_type =
+        DataTypeToNgraphDataType(ctx->InputType("in_0"));
+    if (ctx->Attr<bool>("has_int_operand")) {
+      int64_t value = ctx->Attr<int64_t>("int_operand");
+      return ngraph::op::Constant::create(data_type, ngraph::Shape({}),
+                                          std::vector<int64_t>{value});
+    } else if (ctx->Attr<bool>("has_float_operand")) {
+      double value = ctx->Attr<double>("float_operand");
+      return ngraph::op::Constant::create(data_type, ngraph::Shape({}),
+                                          std::vector<double>{value});
+    }
+    UNIMPLEMENTED();
+    return nullptr;
+  }
+};
+
+REGISTER_OPENVINO_OP_KERNEL(scalar_add, ScalarBinaryOp<ngraph::op::v1::Add>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(scalar_sub,
+                            ScalarBinaryOp<ngraph::op::v1::Subtract>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(scalar_mul,
+                            ScalarBinaryOp<ngraph::op::v1::Multiply>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(scalar_div,
+                            ScalarBinaryOp<ngraph::op::v1::Divide>)
+    .EnableTrainPhase()
+    .Finalize();
+REGISTER_OPENVINO_OP_KERNEL(scalar_pow, ScalarBinaryOp<ngraph::op::v1::Power>)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
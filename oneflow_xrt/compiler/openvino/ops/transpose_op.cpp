@@ -0,0 +1,51 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <ngraph/op/constant.hpp>
+#include <ngraph/op/transpose.hpp>
+
+#include "oneflow_xrt/compiler/openvino/ops/op_context.h"
+#include "oneflow_xrt/compiler/openvino/ops/op_kernel.h"
+
+namespace oneflow {
+namespace xrt {
+namespace openvino {
+
+class TransposeOp : public OpenvinoOpKernel {
+ public:
+  void Compile(OpenvinoOpContext* ctx) override {
+    const auto& perm = ctx->Attr<std::vector<int32_t>>("perm");
+    Shape in_shape = ctx->InputShape("input_0");
+    CHECK_EQ(perm.size(), in_shape.NumAxes());
+
+    std::shared_ptr<ngraph::Node> perm_node =
+        std::make_shared<ngraph::op::Constant>(
+            ngraph::element::i64, ngraph::Shape({perm.size()}),
+            std::vector<int64_t>(perm.begin(), perm.end()));
+    std::shared_ptr<ngraph::Node> ngraph_node =
+        std::make_shared<ngraph::op::v1::Transpose>(ctx->Input("input_0"),
+                                                    perm_node);
+    ngraph_node->set_friendly_name(ctx->op_name().c_str());
+    ctx->SetOutput("output_0", ngraph_node);
+  }
+};
+
+REGISTER_OPENVINO_OP_KERNEL(transpose, TransposeOp)
+    .EnableTrainPhase()
+    .Finalize();
+
+}  // namespace openvino
+}  // namespace xrt
+}  // namespace oneflow
@@ -18,8 +18,12 @@ limitations under the License.
 #include <list>
 #include <map>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
+#include "oneflow_xrt/common/parallel.h"
+#include "oneflow_xrt/common/timer.h"
 #include "oneflow_xrt/common/typedef.h"
 #include "oneflow_xrt/compiler/passes/options.h"
 #include "oneflow_xrt/graph/graph.h"
@@ -51,65 +55,90 @@ class BuildSubGraphPass {
 void BuildSubGraphPass::Run(XrtGraph* graph, const ClusteringOptions& options) {
   // create xrt launch nodes
   std::map<int64_t, XrtNode*> launch_nodes;
-  CreateLaunchNodes(graph, &launch_nodes);
+  {
+    ScopedTimer timer("BuildSubGraphPass: create launch nodes");
+    CreateLaunchNodes(graph, &launch_nodes);
+  }
 
-  // redirect all outer edges of the launch nodes
-  std::map<int64_t, std::set<XrtNode*>> folded_nodes;
-  for (XrtNode* node : graph->Nodes()) {
-    int64_t cluster_id = node->cluster_id();
-    if (cluster_id != -1 && node->type() != _XrtLaunchOpType) {
-      XrtNode* launch_node = launch_nodes[cluster_id];
-      // redirect input edges
-      for (XrtEdge* edge : node->in_edges()) {
-        XrtNode* start = edge->start();
-        if (start->cluster_id() != cluster_id) {
-          edge->SetEnd(launch_node);
-          launch_node->AddInEdge(edge);
+  // redirect all outer edges of the launch nodes. The folded nodes of each
+  // cluster are ordered by unique id rather than by address, so that the
+  // subgraphs and the launch functions built from them are deterministic
+  std::map<int64_t, std::map<int64_t, XrtNode*>> folded_nodes;
+  {
+    ScopedTimer timer("BuildSubGraphPass: redirect edges");
+    for (XrtNode* node : graph->Nodes()) {
+      int64_t cluster_id = node->cluster_id();
+      if (cluster_id != -1 && node->type() != _XrtLaunchOpType) {
+        XrtNode* launch_node = launch_nodes[cluster_id];
+        // redirect input edges
+        for (XrtEdge* edge : node->in_edges()) {
+          XrtNode* start = edge->start();
+          if (start->cluster_id() != cluster_id) {
+            edge->SetEnd(launch_node);
+            launch_node->AddInEdge(edge);
+          }
         }
-      }
-      // redirect output edges
-      for (XrtEdge* edge : node->out_edges()) {
-        XrtNode* end = edge->end();
-        if (end->cluster_id() != cluster_id) {
-          edge->SetStart(launch_node);
-          launch_node->AddOutEdge(edge);
+        // redirect output edges
+        for (XrtEdge* edge : node->out_edges()) {
+          XrtNode* end = edge->end();
+          if (end->cluster_id() != cluster_id) {
+            edge->SetStart(launch_node);
+            launch_node->AddOutEdge(edge);
+          }
         }
+        folded_nodes[cluster_id].emplace(node->unique_id(), node);
       }
-      folded_nodes[cluster_id].insert(node);
     }
   }
 
   // build subgraph for xrt launch nodes and repair error connections
   // caused by redirect. Add argument nodes and create connections
   // between them and the folded nodes
-  for (auto& kv : folded_nodes) {
-    int64_t cluster_id = kv.first;
-    XrtNode* launch_node = launch_nodes[cluster_id];
-    XrtGraph* sub_graph = graph->AddSubgraphForNode(launch_node->unique_id());
-    sub_graph->set_engine(options.engine);
-
-    std::map<int64_t, XrtNode*> sub_graph_nodes;
-    for (XrtNode* n : kv.second) {
-      XrtNode* node = sub_graph->AddNode(n->clone());
-      sub_graph_nodes[n->unique_id()] = node;
+  {
+    ScopedTimer timer("BuildSubGraphPass: build subgraphs");
+    // subgraphs are registered in the outer graph sequentially, and then
+    // each of them is filled by a separate task which only reads the outer
+    // graph and writes its own subgraph
+    std::vector<std::pair<XrtGraph*, const std::map<int64_t, XrtNode*>*>>
+        tasks;
+    tasks.reserve(folded_nodes.size());
+    for (const auto& kv : folded_nodes) {
+      XrtNode* launch_node = launch_nodes[kv.first];
+      XrtGraph* sub_graph = graph->AddSubgraphForNode(launch_node->unique_id());
+      sub_graph->set_engine(options.engine);
+      tasks.emplace_back(sub_graph, &kv.second);
+    }
+    ParallelFor(tasks.size(), [&](int64_t i) {
+      XrtGraph* sub_graph = tasks[i].first;
+      std::map<int64_t, XrtNode*> sub_graph_nodes;
+      for (const auto& it : *tasks[i].second) {
+        XrtNode* n = it.second;
+        XrtNode* node = sub_graph->AddNode(n->clone());
+        sub_graph_nodes[n->unique_id()] = node;
 
-      // rebuild inputs if the end node of input edges has been changed,
-      // otherwise repair input for the node of the subgraph
-      RebuildSubgraphInputs(node, n, sub_graph, &sub_graph_nodes);
+        // rebuild inputs if the end node of input edges has been changed,
+        // otherwise repair input for the node of the subgraph
+        RebuildSubgraphInputs(node, n, sub_graph, &sub_graph_nodes);
 
-      // rebuild outputs same as rebuilding the inputs
-      RebuildSubgraphOutputs(node, n, sub_graph, &sub_graph_nodes);
-    }
-    // divide argument nodes if they have multiple inputs or outputs with
-    // different argument (or `LogicalBlobId`), and then fill their names
-    DivideEntryAndReturnNodes(sub_graph);
+        // rebuild outputs same as rebuilding the inputs
+        RebuildSubgraphOutputs(node, n, sub_graph, &sub_graph_nodes);
+      }
+      // divide argument nodes if they have multiple inputs or outputs with
+      // different argument (or `LogicalBlobId`), and then fill their names
+      DivideEntryAndReturnNodes(sub_graph);
+    });
   }
 
-  for (const XrtNode* node : graph->Nodes()) {
-    CHECK(!node->IsReachable(*node));
+  {
+    ScopedTimer timer("BuildSubGraphPass: check cycles");
+    const auto& nodes = graph->Nodes();
+    ParallelFor(nodes.size(), [&](int64_t i) {
+      CHECK(!nodes[i]->IsReachable(*nodes[i]));
+    });
   }
 
   if (!options.dump_subgraph_dir.empty()) {
+    ScopedTimer timer("BuildSubGraphPass: dump subgraphs");
     DumpSubgraphs(graph, options.dump_subgraph_dir);
   }
 }
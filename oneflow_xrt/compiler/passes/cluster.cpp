@@ -159,6 +159,7 @@ void ClusterNode::Merge(ClusterNode& other) {
   }
 
   FoldNodes(other.folded_nodes());
+  has_backward_node_ = has_backward_node_ || other.has_backward_node();
 }
 
 bool ClusterNode::TryMerge(ClusterNode& other, bool strict_sbp_policy = true) {
@@ -177,7 +178,9 @@ bool ClusterNode::TryMerge(ClusterNode& other, bool strict_sbp_policy = true) {
 }
 
 ClusterNodePtr BuildClusterNode(const XrtNode* node, int64_t id) {
-  return std::make_shared<ClusterNode>(node, id);
+  auto cluster_node = std::make_shared<ClusterNode>(node, id);
+  cluster_node->set_has_backward_node(IsBackwardNode(node));
+  return cluster_node;
 }
 
 ClusterEdgePtr BuildClusterEdge(const ClusterNode* start,
@@ -110,6 +110,13 @@ class ClusterNode {
 
   virtual bool IsModelUpdate() const { return IsModelUpdateNode(xrt_node_); }
 
+  // whether any folded node is a backward node, which is cached since the
+  // scope lookup is not cheap
+  bool has_backward_node() const { return has_backward_node_; }
+  void set_has_backward_node(bool has_backward_node) {
+    has_backward_node_ = has_backward_node;
+  }
+
   bool operator==(const ClusterNode& other) const {
     return cluster_id_ == other.cluster_id_;
   }
@@ -129,6 +136,7 @@ class ClusterNode {
  private:
   const XrtNode* xrt_node_;
   int64_t cluster_id_ = -1;
+  bool has_backward_node_ = false;
 
   std::set<ClusterNode*> folded_nodes_;
   std::set<ClusterEdge*> in_edges_;
@@ -13,9 +13,13 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <algorithm>
+#include <unordered_map>
+
 #include "oneflow_xrt/compiler/passes/cluster.h"
 #include "oneflow_xrt/compiler/passes/options.h"
 #include "oneflow_xrt/graph/graph.h"
+#include "oneflow_xrt/graph/node_util.h"
 
 namespace oneflow {
 namespace xrt {
@@ -30,7 +34,8 @@ class MarkClusterIdPass {
 
  private:
   void BuildClusterNodesAndEdges(XrtGraph* graph);
-  void ClusteringSubgraphs(const ClusteringOptions& options);
+  bool ClusteringSubgraphs(const ClusteringOptions& options);
+  bool ClusteringSiblings(const ClusteringOptions& options);
 
   void RemoveInvalidClusterNodes(const ClusteringOptions& options);
 
@@ -41,6 +46,16 @@ class MarkClusterIdPass {
   bool TryToFuseWithParent(ClusterNode* children, ClusterNode* parent,
                            const ClusteringOptions& options);
 
+  bool TryToFuseWithSibling(ClusterNode* sibling, ClusterNode* node,
+                            const ClusteringOptions& options);
+
+  bool IsClusterable(const ClusterNode* node,
+                     const ClusteringOptions& options) const;
+
+  // returns true if merging `lhs` and `rhs` lengthens the critical path
+  bool IsCriticalPathLengthened(const ClusterNode* lhs, const ClusterNode* rhs);
+  void UpdateCriticalPath();
+
  private:
   // root cluster nodes
   std::set<ClusterNode*> root_nodes_;
@@ -49,6 +64,14 @@ class MarkClusterIdPass {
   // running the pass `MarkClusterIdPass`
   std::vector<ClusterNodePtr> allocated_nodes_;
   std::vector<ClusterEdgePtr> allocated_edges_;
+
+  // the longest path from sources to the node (excluding the node itself) and
+  // the longest path from the node to sinks (including the node itself). They
+  // are recomputed lazily after the cluster graph has been changed
+  std::unordered_map<const ClusterNode*, int64_t> top_levels_;
+  std::unordered_map<const ClusterNode*, int64_t> bottom_levels_;
+  int64_t critical_path_length_ = 0;
+  bool critical_path_dirty_ = true;
 };
 
 namespace algorithm {
@@ -59,6 +82,67 @@ struct GraphTypeTrait<MarkClusterIdPass> {
 };
 }  // namespace algorithm
 
+// the execution cost of a cluster is estimated by the number of folded nodes,
+// and a non-identity edge costs one more step for the boxing (communication)
+static int64_t ClusterCost(const ClusterNode* node) { return node->size(); }
+
+static int64_t EdgeCost(const ClusterEdge* edge) {
+  return edge->IsIdentity() ? 0 : 1;
+}
+
+// the compiled update kernels always read the learning rate from the input
+// and have no `skip_if` for the dynamic loss scaling, and the bias correction
+// of adam needs the inputs `beta1_t` and `beta2_t`
+static bool IsUnsupportedModelUpdate(const XrtNode* node) {
+  if (!IsModelUpdateNode(node)) {
+    return false;
+  }
+  if (!node->conf().has_user_conf()) {
+    return true;
+  }
+  const auto& user_conf = node->conf().user_conf();
+  auto HasInput = [&](const std::string& name) {
+    const auto& it = user_conf.input().find(name);
+    return it != user_conf.input().end() && it->second.s_size() > 0;
+  };
+  if (HasInput("skip_if") || !HasInput("learning_rate")) {
+    return true;
+  }
+  if (node->type() == "adam_update") {
+    const auto& it = user_conf.attr().find("do_bias_correction");
+    bool do_bias_correction =
+        it != user_conf.attr().end() && it->second.at_bool();
+    if (do_bias_correction && (!HasInput("beta1_t") || !HasInput("beta2_t"))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool HasUnsupportedModelUpdate(const ClusterNode* node) {
+  for (const ClusterNode* folded_node : node->folded_nodes()) {
+    if (IsUnsupportedModelUpdate(folded_node->xrt_node())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// the compiled random ops draw from the XLA generator, which ignores the seed
+// and the generator of the OneFlow ops
+static bool IsRandomNode(const XrtNode* node) {
+  return node->type() == "dropout" || node->type() == "random_mask_like";
+}
+
+static bool HasRandomNode(const ClusterNode* node) {
+  for (const ClusterNode* folded_node : node->folded_nodes()) {
+    if (IsRandomNode(folded_node->xrt_node())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void MarkClusterIdPass::BuildClusterNodesAndEdges(XrtGraph* graph) {
   std::map<int64_t, ClusterNode*> cluster_nodes;
   algorithm::TopologyVisit(*graph, [&](XrtNode* node) {
@@ -84,16 +168,23 @@ void MarkClusterIdPass::BuildClusterNodesAndEdges(XrtGraph* graph) {
   }
 }
 
-void MarkClusterIdPass::ClusteringSubgraphs(const ClusteringOptions& options) {
+bool MarkClusterIdPass::IsClusterable(const ClusterNode* node,
+                                      const ClusteringOptions& options) const {
+  return node->IsCompiled(options.engine) &&
+         (!node->IsModelUpdate() || options.fuse_model_update) &&
+         (options.cluster_random_ops || !HasRandomNode(node)) &&
+         !HasUnsupportedModelUpdate(node);
+}
+
+bool MarkClusterIdPass::ClusteringSubgraphs(const ClusteringOptions& options) {
+  bool changed = false;
   for (int i = 0; i < options.max_iteration; ++i) {
     bool has_changed = false;
     std::vector<ClusterNode*> ordered_nodes;
     algorithm::TopologyVisit(*this, [&](ClusterNode* node) {
-      if (!node->IsCompiled(options.engine) ||
-          node->IsModelUpdate() /* skip model update op */) {
-        return;
+      if (IsClusterable(node, options)) {
+        ordered_nodes.emplace_back(node);
       }
-      ordered_nodes.emplace_back(node);
     });
 
     for (int i = ordered_nodes.size() - 1; i >= 0; --i) {
@@ -103,7 +194,7 @@ void MarkClusterIdPass::ClusteringSubgraphs(const ClusteringOptions& options) {
         candidate_parents.insert(edge->start());
       }
       for (ClusterNode* parent : candidate_parents) {
-        if (parent->IsCompiled(options.engine) &&
+        if (IsClusterable(parent, options) &&
             (parent->size() + node->size()) <= options.maximum_nodes &&
             TryToFuseWithParent(node, parent, options)) {
           has_changed = true;
@@ -115,13 +206,209 @@ void MarkClusterIdPass::ClusteringSubgraphs(const ClusteringOptions& options) {
     if (!has_changed) {
       break;
     }
+    changed = true;
   }
+  return changed;
+}
+
+// horizontal fusion merges the clusters which consume the same producer
+// through identity edges. The producer itself may not be compiled, e.g. the
+// shared input of the q/k/v projections
+bool MarkClusterIdPass::ClusteringSiblings(const ClusteringOptions& options) {
+  bool changed = false;
+  for (int i = 0; i < options.max_iteration; ++i) {
+    bool has_changed = false;
+    std::vector<ClusterNode*> ordered_nodes;
+    algorithm::TopologyVisit(
+        *this, [&](ClusterNode* node) { ordered_nodes.emplace_back(node); });
+
+    for (ClusterNode* parent : ordered_nodes) {
+      if (root_nodes_.count(parent) == 0) {
+        continue;
+      }
+      std::vector<ClusterNode*> siblings;
+      std::set<ClusterNode*> visited;
+      for (const ClusterEdge* edge : parent->out_edges()) {
+        ClusterNode* node = edge->end();
+        if (edge->is_control_edge() || !visited.insert(node).second) {
+          continue;
+        }
+        if (root_nodes_.count(node) > 0 && IsClusterable(node, options)) {
+          siblings.emplace_back(node);
+        }
+      }
+
+      // greedily merge each sibling into the first sibling that accepts it
+      std::vector<ClusterNode*> leaders;
+      for (ClusterNode* node : siblings) {
+        bool is_fused = false;
+        for (ClusterNode* leader : leaders) {
+          if ((leader->size() + node->size()) <= options.maximum_nodes &&
+              TryToFuseWithSibling(leader, node, options)) {
+            root_nodes_.erase(node);
+            is_fused = true;
+            break;
+          }
+        }
+        if (is_fused) {
+          has_changed = true;
+        } else {
+          leaders.emplace_back(node);
+        }
+      }
+    }
+    if (!has_changed) {
+      break;
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+bool MarkClusterIdPass::TryToFuseWithSibling(ClusterNode* sibling,
+                                             ClusterNode* node,
+                                             const ClusteringOptions& options) {
+  if (sibling->device() != node->device() ||
+      sibling->IsModelUpdate() != node->IsModelUpdate()) {
+    return false;
+  }
+  // all the edges from a common producer should be identity, which ensures
+  // that both siblings have the same sbp and time shape as the producer
+  std::set<ClusterNode*> sibling_parents;
+  for (const ClusterEdge* edge : sibling->in_edges()) {
+    if (!edge->is_control_edge() && !edge->is_fusion_disabled() &&
+        edge->IsIdentity()) {
+      sibling_parents.insert(edge->start());
+    }
+  }
+  bool has_common_parent = false;
+  for (const ClusterEdge* edge : node->in_edges()) {
+    if (edge->is_control_edge() || !sibling_parents.count(edge->start())) {
+      continue;
+    }
+    if (edge->is_fusion_disabled() || !edge->IsIdentity()) {
+      return false;
+    }
+    has_common_parent = true;
+  }
+  if (!has_common_parent) {
+    return false;
+  }
+  // the strict dependencies check as the parent and children fusion. The
+  // merged cluster starts after all the producers of both siblings and its
+  // consumers wait for both siblings, so the siblings are only merged if
+  // they have the same producers and the same consumers
+  if (!options.ignore_pipeline && !options.preserve_critical_path) {
+    auto Producers = [](const ClusterNode* n) {
+      std::set<const ClusterNode*> producers;
+      for (const ClusterEdge* edge : n->in_edges()) {
+        producers.insert(edge->start());
+      }
+      return producers;
+    };
+    auto Consumers = [](const ClusterNode* n) {
+      std::set<const ClusterNode*> consumers;
+      for (const ClusterEdge* edge : n->out_edges()) {
+        consumers.insert(edge->end());
+      }
+      return consumers;
+    };
+    if (Producers(sibling) != Producers(node) ||
+        Consumers(sibling) != Consumers(node)) {
+      return false;
+    }
+  }
+  if (options.preserve_critical_path &&
+      IsCriticalPathLengthened(sibling, node)) {
+    return false;
+  }
+  // merging fails if there is any dependency path between the siblings
+  if (sibling->TryMerge(*node, options.strict_sbp_policy)) {
+    critical_path_dirty_ = true;
+    return true;
+  }
+  return false;
+}
+
+void MarkClusterIdPass::UpdateCriticalPath() {
+  std::vector<ClusterNode*> ordered_nodes;
+  algorithm::TopologyVisit(
+      *this, [&](ClusterNode* node) { ordered_nodes.emplace_back(node); });
+
+  top_levels_.clear();
+  bottom_levels_.clear();
+  for (const ClusterNode* node : ordered_nodes) {
+    int64_t top_level = 0;
+    for (const ClusterEdge* edge : node->in_edges()) {
+      const ClusterNode* start = edge->start();
+      top_level = std::max(top_level, top_levels_[start] + ClusterCost(start) +
+                                          EdgeCost(edge));
+    }
+    top_levels_[node] = top_level;
+  }
+  critical_path_length_ = 0;
+  for (auto it = ordered_nodes.rbegin(); it != ordered_nodes.rend(); ++it) {
+    const ClusterNode* node = *it;
+    int64_t bottom_level = 0;
+    for (const ClusterEdge* edge : node->out_edges()) {
+      bottom_level =
+          std::max(bottom_level, bottom_levels_[edge->end()] + EdgeCost(edge));
+    }
+    bottom_levels_[node] = bottom_level + ClusterCost(node);
+    critical_path_length_ = std::max(
+        critical_path_length_, top_levels_[node] + bottom_levels_[node]);
+  }
+  critical_path_dirty_ = false;
+}
+
+bool MarkClusterIdPass::IsCriticalPathLengthened(const ClusterNode* lhs,
+                                                 const ClusterNode* rhs) {
+  if (critical_path_dirty_) {
+    UpdateCriticalPath();
+  }
+  // the merged node can not start until all of its inputs are ready, and all
+  // of its outputs are not available until both `lhs` and `rhs` are done.
+  // Since the ancestors and descendants of the merged node are not affected,
+  // the longest path through it can be computed exactly from the levels
+  int64_t top_level = 0;
+  int64_t bottom_level = 0;
+  for (const ClusterNode* node : {lhs, rhs}) {
+    for (const ClusterEdge* edge : node->in_edges()) {
+      const ClusterNode* start = edge->start();
+      if (start != lhs && start != rhs) {
+        top_level =
+            std::max(top_level, top_levels_.at(start) + ClusterCost(start) +
+                                    EdgeCost(edge));
+      }
+    }
+    for (const ClusterEdge* edge : node->out_edges()) {
+      const ClusterNode* end = edge->end();
+      if (end != lhs && end != rhs) {
+        bottom_level =
+            std::max(bottom_level, bottom_levels_.at(end) + EdgeCost(edge));
+      }
+    }
+  }
+  int64_t path_length =
+      top_level + ClusterCost(lhs) + ClusterCost(rhs) + bottom_level;
+  return path_length > critical_path_length_;
 }
 
 bool MarkClusterIdPass::TryToFuseWithParent(ClusterNode* children,
                                             ClusterNode* parent,
                                             const ClusteringOptions& options) {
-  if (!options.ignore_pipeline) {
+  // model update ops are never fused with the forward or backward ops
+  if (parent->IsModelUpdate() != children->IsModelUpdate()) {
+    return false;
+  }
+  // the backward ops are merged into the forward cluster they depend on
+  // regardless of the pipeline and critical path, so that the activations
+  // can be rematerialized instead of being kept alive across the clusters
+  bool fuse_forward_backward = options.fuse_forward_backward &&
+                               !parent->has_backward_node() &&
+                               children->has_backward_node();
+  if (!options.ignore_pipeline && !options.preserve_critical_path &&
+      !fuse_forward_backward) {
     for (const ClusterEdge* edge : parent->out_edges()) {
       if (edge->end() !=
               children && /* !children->IsReachable(*(edge->end())) */
@@ -138,8 +425,16 @@ bool MarkClusterIdPass::TryToFuseWithParent(ClusterNode* children,
           can_be_fusion && !edge->is_fusion_disabled() && edge->IsIdentity();
     }
   }
-  if (can_be_fusion) {
-    return parent->TryMerge(*children, options.strict_sbp_policy);
+  if (!can_be_fusion) {
+    return false;
+  }
+  if (options.preserve_critical_path && !fuse_forward_backward &&
+      IsCriticalPathLengthened(parent, children)) {
+    return false;
+  }
+  if (parent->TryMerge(*children, options.strict_sbp_policy)) {
+    critical_path_dirty_ = true;
+    return true;
   }
   return false;
 }
@@ -167,7 +462,8 @@ void MarkClusterIdPass::RemoveInvalidClusterNodes(
   std::vector<ClusterNode*> removing_clusters;
   for (ClusterNode* node : root_nodes_) {
     if (!node->IsCompiled(options.engine) || node->size() < min_nodes ||
-        node->size() > max_nodes) {
+        node->size() > max_nodes || HasUnsupportedModelUpdate(node) ||
+        (!options.cluster_random_ops && HasRandomNode(node))) {
       removing_clusters.emplace_back(node);
     }
   }
@@ -181,6 +477,10 @@ void MarkClusterIdPass::Run(XrtGraph* graph, const ClusteringOptions& options) {
 
   // clustering nodes iteratively
   ClusteringSubgraphs(options);
+  if (options.horizontal_fusion && ClusteringSiblings(options)) {
+    // merged siblings may expose new chances to fuse with their children
+    ClusteringSubgraphs(options);
+  }
 
   RemoveInvalidClusterNodes(options);
   RerankClusterIds();
@@ -35,9 +35,34 @@ struct ClusteringOptions {
 
   // ignore strict dependencies analysis
   bool ignore_pipeline = true;
+  // reject the merges that lengthen the estimated critical path of the
+  // clustered graph, which keeps the overlap between independent branches
+  // (e.g. compute and communication). It takes the place of the strict
+  // dependencies analysis if `ignore_pipeline` is false
+  bool preserve_critical_path = false;
   // check is satisfy strict sbp policy
   bool strict_sbp_policy = true;
 
+  // merge independent sibling clusters that consume the same input, such as
+  // the q/k/v projections in attention, to reduce the number of launch ops
+  bool horizontal_fusion = false;
+
+  // cluster the model update ops, which are only merged with each other so
+  // that all the parameters sharing the same learning rate are updated by one
+  // fused computation. The update ops with `skip_if` or without the
+  // `learning_rate` input are never clustered
+  bool fuse_model_update = false;
+
+  // allow the backward (gradient) ops to be merged into the clusters of the
+  // forward ops they depend on, even if the pipeline or critical path check
+  // rejects it, so that the activations can be rematerialized in the cluster
+  bool fuse_forward_backward = false;
+
+  // cluster the random ops (dropout and random_mask_like), whose compiled
+  // kernels ignore the seed and the generator of the ops, so the results
+  // are not reproducible by the OneFlow seed
+  bool cluster_random_ops = false;
+
   // maximum iteration count for iteratively clustering. -1 means
   // that it will always iteratively merge as much as possible until no
   // node can be merged
@@ -48,6 +73,7 @@ struct ClusteringOptions {
 
 struct ReBuildJobOptions {
   bool use_fp16 = false;
+  bool use_bf16 = false;
   bool use_int8 = false;
 
   std::string int8_calibration = "";
@@ -59,6 +85,30 @@ struct ReBuildJobOptions {
   int64_t max_batch_size = 1;
   int64_t max_workspace_size = -1;
 
+  // number of inference streams, 0 means that it's decided by the engine
+  int64_t num_streams = 1;
+
+  // number of host threads used by the engine, -1 means that it's decided by
+  // the engine
+  int64_t host_num_threads = -1;
+  // bind the host threads to "NONE", "CORE" or "NUMA"
+  std::string host_thread_binding = "";
+
+  // directory to save and reuse the compiled results across processes
+  std::string engine_cache_dir = "";
+
+  // share the weights with the engine instead of folding them as constants
+  bool share_weights = false;
+
+  // xla::DebugOptions in text format for the XLA clusters
+  std::string xla_debug_options = "";
+  // directory to dump the optimized HLO of the XLA clusters
+  std::string xla_dump_hlo_dir = "";
+  // rematerialize the XLA clusters within `max_workspace_size`
+  bool xla_rematerialization = false;
+  // also run the elementwise ops of the XLA clusters in low precision
+  bool xla_aggressive_mixed_precision = false;
+
   std::string dump_subgraph_dir = "";
 };
 
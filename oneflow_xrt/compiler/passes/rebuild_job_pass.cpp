@@ -25,6 +25,9 @@ limitations under the License.
 #include "oneflow/core/job/job_builder.h"
 #include "oneflow/core/operator/op_conf.pb.h"
 #include "oneflow/core/operator/operator.h"
+#include "oneflow_xrt/common/launch_proto.h"
+#include "oneflow_xrt/common/parallel.h"
+#include "oneflow_xrt/common/timer.h"
 #include "oneflow_xrt/common/typedef.h"
 #include "oneflow_xrt/compiler/passes/options.h"
 #include "oneflow_xrt/graph/argument.h"
@@ -76,14 +79,26 @@ class FoldSubgraphBuilder {
   void Build() {
     // 1.Fixup output blob names for launch nodes, and infect the
     //   changes to the input of next nodes
-    FixupInOutBlobNames();
+    {
+      ScopedTimer timer("RebuildJobPass: fixup blob names");
+      FixupInOutBlobNames();
+    }
     // 2.Add XrtLaunch operator to the job
-    BuildXrtLaunchOps();
+    {
+      ScopedTimer timer("RebuildJobPass: build launch ops");
+      BuildXrtLaunchOps();
+    }
     // 3.Replace control_in_op_name by the XrtLaunch operator name if
     //   the operator has been folded
-    FixupControlInOpNames();
+    {
+      ScopedTimer timer("RebuildJobPass: fixup control in op names");
+      FixupControlInOpNames();
+    }
     // 4.Finally remove the folded operators
-    RemoveLaunchFoldedOps();
+    {
+      ScopedTimer timer("RebuildJobPass: remove folded ops");
+      RemoveLaunchFoldedOps();
+    }
   }
 
  private:
@@ -95,6 +110,10 @@ class FoldSubgraphBuilder {
 
   void BuildXrtLaunchOps();
 
+  void AddXrtLaunchOp(int index);
+
+  void BuildXrtLaunchProto(int index, XrtLaunchProto* proto) const;
+
   void FixupInOutBlobNames();
 
   void RemoveLaunchFoldedOps();
@@ -113,7 +132,6 @@ class FoldSubgraphBuilder {
   std::vector<std::vector<const XrtNode*>> folded_nodes_;
 
   std::map<std::string, std::string> fixedup_names_;
-  std::map<std::string /*op name*/, XrtLaunchProto> launch_attrs_;
 };
 
 FoldSubgraphBuilder::FoldSubgraphBuilder(XrtGraph* graph, Job* job,
@@ -176,6 +194,11 @@ void FoldSubgraphBuilder::buildFunction(const XrtNode* launch_node,
   }
 }
 
+bool IsTrainableVariable(const XrtNode* node) {
+  const auto& conf = node->conf();
+  return conf.has_variable_conf() && conf.variable_conf().trainable();
+}
+
 void AddInOutBlobNames(const XrtNode* node, UserOpConf* launch_conf) {
   std::map<std::string, std::string> input_args;
   for (const XrtEdge* edge : node->in_edges()) {
@@ -207,115 +230,29 @@ void AddInOutBlobNames(const XrtNode* node, UserOpConf* launch_conf) {
 }
 
 void FoldSubgraphBuilder::BuildXrtLaunchOps() {
+  // adding operators mutates the job, so the launch ops are added one by one
   for (int i = 0; i < launch_nodes_.size(); ++i) {
-    const XrtNode* node = launch_nodes_[i];
-    {
-      // make xrt launch op
-      OperatorConf op_conf = folded_nodes_[i][0]->conf();
-      op_conf.set_name(node->name());
-      op_conf.clear_op_type();
-
-      UserOpConf* launch_conf = op_conf.mutable_user_conf();
-      launch_conf->set_op_type_name(_XrtLaunchOpType);
-
-      // add inputs and outputs
-      AddInOutBlobNames(node, launch_conf);
-
-      CHECK_GT(folded_nodes_[i].size(), 0);
-      const ParallelConf& parallel_conf = CHECK_JUST(
-          builder_->ParallelConf4OpName(folded_nodes_[i][0]->name()));
-      builder_->AddOps(parallel_conf, {op_conf});
-
-      // update xrt launch op nd sbp signatures
-      NdSbpSignature nd_sbp_signature;
-      auto* bn_in_op2nd_sbp = nd_sbp_signature.mutable_bn_in_op2nd_sbp();
-      for (const XrtEdge* edge : node->in_edges()) {
-        const auto& meta_data = edge->argument().meta_data();
-        (*bn_in_op2nd_sbp)[meta_data.consume_key] = meta_data.nd_sbp[1];
-      }
-      for (const XrtEdge* edge : node->out_edges()) {
-        const auto& meta_data = edge->argument().meta_data();
-        (*bn_in_op2nd_sbp)[meta_data.produce_key] = meta_data.nd_sbp[0];
-      }
-      builder_->AddNdSbpSignature4OpName(node->name(), nd_sbp_signature);
-    }
-
-    std::set<std::string> liveout_entries;
-    XrtLaunchProto& proto = launch_attrs_[node->name()];
-
-    const auto& engine = node->sub_graph()->engine();
-    // add execute options
-    auto* options = proto.mutable_options();
-    options->set_engine(engine);
-    options->set_device(node->device());
-    options->set_use_fp16(options_.use_fp16);
-    options->set_use_int8(options_.use_int8);
-    options->set_int8_calibration(options_.int8_calibration);
-    options->set_force_compile(options_.force_compile);
-    options->set_strict_types(options_.strict_types);
-    options->set_force_precision_constraints(
-        options_.force_precision_constraints);
-    options->set_max_batch_size(options_.max_batch_size);
-    options->set_max_workspace_size(options_.max_workspace_size);
-
-    // build function
-    buildFunction(node, engine, &liveout_entries, proto.mutable_function());
-
-    // add liveout entries
-    for (const auto& entry : liveout_entries) {
-      proto.add_liveout_entries(entry);
-    }
-
-    // save function logical blob descs
-    const auto& lbn2logical_blob_desc =
-        builder_->job().helper().lbn2logical_blob_desc();
-    const auto& op_name2arg_signature =
-        builder_->job().helper().op_name2arg_signature();
-    auto* logical_blob_descs = proto.mutable_logical_blob_descs();
-
-    auto CopyLogicalBlobDesc = [&](const std::string& arg_name) {
-      const auto src_it = lbn2logical_blob_desc.find(arg_name);
-      CHECK(src_it != lbn2logical_blob_desc.end());
-      auto dst_it = logical_blob_descs->find(arg_name);
-      if (dst_it != logical_blob_descs->end()) {
-        CHECK(dst_it->second == src_it->second);
-      } else {
-        (*logical_blob_descs)[arg_name] = src_it->second;
-      }
-    };
-    for (const XrtNode* sub_node : node->sub_graph()->Nodes()) {
-      if (sub_node->IsEntryNode() || sub_node->IsReturnNode()) {
-        continue;
-      }
-      const auto& it = op_name2arg_signature.find(sub_node->name());
-      CHECK(it != op_name2arg_signature.end());
-      for (const auto& p : it->second.bn_in_op2lbi()) {
-        std::string arg_name = GenLogicalBlobName(p.second);
-        CopyLogicalBlobDesc(arg_name);
-      }
-    }
-    // save the launch op outputs logical blob descs
-    for (const auto& output : proto.function().output()) {
-      const auto& it = logical_blob_descs->find(output.value());
-      CHECK(it != logical_blob_descs->end());
-      (*logical_blob_descs)[output.name()] = it->second;
-    }
+    AddXrtLaunchOp(i);
+  }
 
-    // save sbp signatures for the folded nodes
-    auto* nd_sbp_signatures = proto.mutable_nd_sbp_signatures();
-    for (const auto& node_conf : proto.function().node()) {
-      const std::string& node_name = node_conf.name();
-      (*nd_sbp_signatures)[node_name] =
-          builder_->NdSbpSignature4OpName(node_name);
-    }
-    (*nd_sbp_signatures)[node->name()] =
-        builder_->NdSbpSignature4OpName(node->name());
+  // building the launch protos only reads the job and the subgraphs, so they
+  // are built and serialized in parallel for each cluster
+  std::vector<XrtLaunchProto> launch_protos(launch_nodes_.size());
+  std::vector<std::string> launch_attrs(launch_nodes_.size());
+  ParallelFor(launch_nodes_.size(), [&](int64_t i) {
+    BuildXrtLaunchProto(i, &launch_protos[i]);
+    launch_attrs[i] = SerializeLaunchProto(launch_protos[i]);
+  });
 
-    // update xrt launch op attribute `proto`
+  // update xrt launch op attribute `proto` in the order of the launch nodes
+  for (int i = 0; i < launch_nodes_.size(); ++i) {
+    const XrtNode* node = launch_nodes_[i];
     auto* op_conf = CHECK_JUST(builder_->MutableOpConf4OpName(node->name()));
-    std::string xrt_launch_attr;
-    google::protobuf::TextFormat::PrintToString(proto, &xrt_launch_attr);
     if (!options_.dump_subgraph_dir.empty()) {
+      // the attribute is binary, so dump the readable text format instead
+      std::string xrt_launch_attr;
+      google::protobuf::TextFormat::PrintToString(launch_protos[i],
+                                                  &xrt_launch_attr);
       std::string dump_file_path = absl::StrCat(options_.dump_subgraph_dir, "/", node->name());
       std::ofstream ofs(dump_file_path.c_str(), std::ofstream::out);
       CHECK(ofs.good())
@@ -325,8 +262,137 @@ void FoldSubgraphBuilder::BuildXrtLaunchOps() {
       ofs.close();
     }
     auto* attr = op_conf->mutable_user_conf()->mutable_attr();
-    (*attr)["proto"].set_at_string(xrt_launch_attr);
+    (*attr)["proto"].set_at_string(launch_attrs[i]);
+  }
+}
+
+void FoldSubgraphBuilder::AddXrtLaunchOp(int index) {
+  const XrtNode* node = launch_nodes_[index];
+  // make xrt launch op
+  OperatorConf op_conf = folded_nodes_[index][0]->conf();
+  op_conf.set_name(node->name());
+  op_conf.clear_op_type();
+
+  UserOpConf* launch_conf = op_conf.mutable_user_conf();
+  launch_conf->set_op_type_name(_XrtLaunchOpType);
+
+  // add inputs and outputs
+  AddInOutBlobNames(node, launch_conf);
+
+  CHECK_GT(folded_nodes_[index].size(), 0);
+  const ParallelConf& parallel_conf = CHECK_JUST(
+      builder_->ParallelConf4OpName(folded_nodes_[index][0]->name()));
+  builder_->AddOps(parallel_conf, {op_conf});
+
+  // update xrt launch op nd sbp signatures
+  NdSbpSignature nd_sbp_signature;
+  auto* bn_in_op2nd_sbp = nd_sbp_signature.mutable_bn_in_op2nd_sbp();
+  for (const XrtEdge* edge : node->in_edges()) {
+    const auto& meta_data = edge->argument().meta_data();
+    (*bn_in_op2nd_sbp)[meta_data.consume_key] = meta_data.nd_sbp[1];
+  }
+  for (const XrtEdge* edge : node->out_edges()) {
+    const auto& meta_data = edge->argument().meta_data();
+    (*bn_in_op2nd_sbp)[meta_data.produce_key] = meta_data.nd_sbp[0];
+  }
+  builder_->AddNdSbpSignature4OpName(node->name(), nd_sbp_signature);
+}
+
+void FoldSubgraphBuilder::BuildXrtLaunchProto(int index,
+                                              XrtLaunchProto* proto) const {
+  const XrtNode* node = launch_nodes_[index];
+  std::set<std::string> liveout_entries;
+
+  const auto& engine = node->sub_graph()->engine();
+  // add execute options
+  auto* options = proto->mutable_options();
+  options->set_engine(engine);
+  options->set_device(node->device());
+  options->set_use_fp16(options_.use_fp16);
+  options->set_use_bf16(options_.use_bf16);
+  options->set_use_int8(options_.use_int8);
+  options->set_int8_calibration(options_.int8_calibration);
+  options->set_force_compile(options_.force_compile);
+  options->set_strict_types(options_.strict_types);
+  options->set_force_precision_constraints(
+      options_.force_precision_constraints);
+  options->set_max_batch_size(options_.max_batch_size);
+  options->set_max_workspace_size(options_.max_workspace_size);
+  options->set_num_streams(options_.num_streams);
+  options->set_host_num_threads(options_.host_num_threads);
+  options->set_host_thread_binding(options_.host_thread_binding);
+  options->set_engine_cache_dir(options_.engine_cache_dir);
+  options->set_share_weights(options_.share_weights);
+  options->set_xla_debug_options(options_.xla_debug_options);
+  options->set_xla_dump_hlo_dir(options_.xla_dump_hlo_dir);
+  options->set_xla_rematerialization(options_.xla_rematerialization);
+  options->set_xla_aggressive_mixed_precision(
+      options_.xla_aggressive_mixed_precision);
+
+  // build function
+  buildFunction(node, engine, &liveout_entries, proto->mutable_function());
+
+  // add liveout entries
+  for (const auto& entry : liveout_entries) {
+    proto->add_liveout_entries(entry);
+  }
+
+  // add variable entries, which are updated by the training and never folded
+  // into the compiled results
+  std::set<std::string> variable_entries(liveout_entries);
+  for (const XrtEdge* edge : node->in_edges()) {
+    if (!edge->IsControlEdge() && IsTrainableVariable(edge->start())) {
+      variable_entries.insert(edge->argument().meta_data().consume_key);
+    }
+  }
+  for (const auto& entry : variable_entries) {
+    proto->add_variable_entries(entry);
+  }
+
+  // save function logical blob descs
+  const auto& lbn2logical_blob_desc =
+      builder_->job().helper().lbn2logical_blob_desc();
+  const auto& op_name2arg_signature =
+      builder_->job().helper().op_name2arg_signature();
+  auto* logical_blob_descs = proto->mutable_logical_blob_descs();
+
+  auto CopyLogicalBlobDesc = [&](const std::string& arg_name) {
+    const auto src_it = lbn2logical_blob_desc.find(arg_name);
+    CHECK(src_it != lbn2logical_blob_desc.end());
+    auto dst_it = logical_blob_descs->find(arg_name);
+    if (dst_it != logical_blob_descs->end()) {
+      CHECK(dst_it->second == src_it->second);
+    } else {
+      (*logical_blob_descs)[arg_name] = src_it->second;
+    }
+  };
+  for (const XrtNode* sub_node : node->sub_graph()->Nodes()) {
+    if (sub_node->IsEntryNode() || sub_node->IsReturnNode()) {
+      continue;
+    }
+    const auto& it = op_name2arg_signature.find(sub_node->name());
+    CHECK(it != op_name2arg_signature.end());
+    for (const auto& p : it->second.bn_in_op2lbi()) {
+      std::string arg_name = GenLogicalBlobName(p.second);
+      CopyLogicalBlobDesc(arg_name);
+    }
+  }
+  // save the launch op outputs logical blob descs
+  for (const auto& output : proto->function().output()) {
+    const auto& it = logical_blob_descs->find(output.value());
+    CHECK(it != logical_blob_descs->end());
+    (*logical_blob_descs)[output.name()] = it->second;
+  }
+
+  // save sbp signatures for the folded nodes
+  auto* nd_sbp_signatures = proto->mutable_nd_sbp_signatures();
+  for (const auto& node_conf : proto->function().node()) {
+    const std::string& node_name = node_conf.name();
+    (*nd_sbp_signatures)[node_name] =
+        builder_->NdSbpSignature4OpName(node_name);
   }
+  (*nd_sbp_signatures)[node->name()] =
+      builder_->NdSbpSignature4OpName(node->name());
 }
 
 void FoldSubgraphBuilder::FixupControlInOpNames() {
@@ -0,0 +1,135 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/passes/shape_inference_cache.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/util/message_differencer.h"
+#include "oneflow_xrt/api/api_internal.h"
+#include "oneflow_xrt/common/env.h"
+
+namespace oneflow {
+namespace xrt {
+
+namespace {
+
+class ShapeInferenceCache {
+ public:
+  static ShapeInferenceCache* Global() {
+    static ShapeInferenceCache cache;
+    return &cache;
+  }
+
+  std::shared_ptr<const InferedFunction> Lookup(
+      const std::string& key, const XrtLaunchProto& proto) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& it = records_.find(key);
+    if (it == records_.end() || !IsSameProto(*it->second->proto, proto)) {
+      return nullptr;
+    }
+    return it->second;
+  }
+
+  std::shared_ptr<const InferedFunction> Record(
+      const std::string& key, std::shared_ptr<const InferedFunction> record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto& it = records_.find(key);
+    if (it != records_.end()) {
+      // keep the first one if the function has been infered by other
+      // threads, and never cache the colliding one
+      return IsSameProto(*it->second->proto, *record->proto) ? it->second
+                                                             : record;
+    }
+    // the number of signatures may be unbounded for dynamic inputs, so simply
+    // start over if the cache is too large
+    if (records_.size() >= capacity_) {
+      records_.clear();
+    }
+    return records_.emplace(key, record).first->second;
+  }
+
+ private:
+  ShapeInferenceCache()
+      : capacity_(EnvToInt64(ONEFLOW_XRT_SHAPE_INFERENCE_CACHE_SIZE, 1024)) {}
+
+  // the launch protos parsed from the same attribute are usually shared, so
+  // the contents are only compared if they are different objects
+  static bool IsSameProto(const XrtLaunchProto& lhs,
+                          const XrtLaunchProto& rhs) {
+    return &lhs == &rhs ||
+           google::protobuf::util::MessageDifferencer::Equals(lhs, rhs);
+  }
+
+  size_t capacity_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const InferedFunction>>
+      records_;
+};
+
+std::string MakeCacheKey(
+    uint64_t function_hash,
+    const std::map<std::string, BlobDesc>& entry_blob_descs,
+    const ParallelContext& parallel_ctx, const ParallelDesc& parallel_desc) {
+  std::string key = absl::StrCat(
+      function_hash, ";", parallel_ctx.parallel_id(), ";",
+      parallel_ctx.parallel_num(), ";", parallel_desc.device_type(), ";",
+      parallel_desc.hierarchy()->ToString());
+  for (const auto& it : entry_blob_descs) {
+    absl::StrAppend(&key, ";", it.first, ":", it.second.shape().ToString(),
+                    ":", it.second.data_type(), ":", it.second.is_dynamic());
+  }
+  return key;
+}
+
+}  // namespace
+
+std::shared_ptr<const InferedFunction> InferFunctionPhysicalShapes(
+    uint64_t function_hash, const std::shared_ptr<const XrtLaunchProto>& proto,
+    const std::map<std::string, BlobDesc>& entry_blob_descs,
+    const ParallelContext& parallel_ctx, const ParallelDesc& parallel_desc) {
+  auto* cache = ShapeInferenceCache::Global();
+  std::string key = MakeCacheKey(function_hash, entry_blob_descs,
+                                 parallel_ctx, parallel_desc);
+  if (auto record = cache->Lookup(key, *proto)) {
+    return record;
+  }
+  ShapeInferenceContext context(
+      &entry_blob_descs, &proto->logical_blob_descs(), &parallel_ctx,
+      &parallel_desc, &proto->nd_sbp_signatures());
+  auto graph = BuildGraph(proto->function());
+  // the engines bind the trainable entries rather than fold them
+  std::unordered_set<std::string> variable_entries(
+      proto->variable_entries().begin(), proto->variable_entries().end());
+  for (XrtNode* node : graph->Nodes()) {
+    if (node->IsEntryNode() && variable_entries.count(node->name()) > 0) {
+      node->set_trainable(true);
+    }
+  }
+  RunShapeInferencePass(graph.get(), context);
+
+  auto record = std::make_shared<InferedFunction>();
+  record->proto = proto;
+  record->graph = graph;
+  record->physical_blob_descs =
+      std::move(*context.infered_physical_blob_descs());
+  return cache->Record(key, record);
+}
+
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,53 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMPILER_PASSES_SHAPE_INFERENCE_CACHE_H_
+#define ONEFLOW_XRT_COMPILER_PASSES_SHAPE_INFERENCE_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/register/blob_desc.h"
+#include "oneflow_xrt/graph/graph.h"
+#include "oneflow_xrt/xrt.pb.h"
+
+namespace oneflow {
+namespace xrt {
+
+struct InferedFunction {
+  // the launch proto the function is infered from, which confirms the hit of
+  // the function hash
+  std::shared_ptr<const XrtLaunchProto> proto;
+  // the function graph whose edges have been filled with the infered
+  // physical arguments
+  std::shared_ptr<const XrtGraph> graph;
+  std::map<std::string, BlobDesc> physical_blob_descs;
+};
+
+// build the graph for the function of the launch proto and infer the physical
+// blob descs. The results are memoized by the function hash, entry blob descs
+// and parallel context, so that the launch op infer functions and the kernel
+// compilation for the same inputs construct the folded operators only once
+std::shared_ptr<const InferedFunction> InferFunctionPhysicalShapes(
+    uint64_t function_hash, const std::shared_ptr<const XrtLaunchProto>& proto,
+    const std::map<std::string, BlobDesc>& entry_blob_descs,
+    const ParallelContext& parallel_ctx, const ParallelDesc& parallel_desc);
+
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMPILER_PASSES_SHAPE_INFERENCE_CACHE_H_
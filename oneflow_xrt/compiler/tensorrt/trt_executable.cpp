@@ -125,6 +125,7 @@ int32_t TrtExecutable::GetBindingIndex(const std::string& name) const {
 
 bool TrtExecutable::Run(const std::vector<Parameter>& inputs,
                         const ExecutableRunOptions& run_options,
+                        std::vector<Parameter>* results,
                         bool block_until_done) {
   if (run_options.common.use_int8() && !calibrator_ &&
       run_options.common.int8_calibration().size()) {
@@ -140,7 +141,7 @@ bool TrtExecutable::Run(const std::vector<Parameter>& inputs,
   }
 
   // all return params are the results of the executable
-  this->results_ = run_options.return_params;
+  *results = run_options.return_params;
 
   const int num_bindings = engine_->getNbBindings();
   std::vector<const Parameter*> binding_params(num_bindings);
@@ -153,7 +154,7 @@ bool TrtExecutable::Run(const std::vector<Parameter>& inputs,
       buffers[index] = input.data();
     }
   }
-  for (const Parameter& output : this->results_) {
+  for (const Parameter& output : *results) {
     // returns -1 if the name is not found
     int index = GetBindingIndex(output.name());
     if (index > -1) {
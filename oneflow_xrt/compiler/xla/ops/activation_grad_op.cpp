@@ -56,6 +56,18 @@ class GeluGradOp : public XlaOpKernel {
 };
 REGISTER_XLA_OP_KERNEL(gelu_grad, GeluGradOp).Finalize();
 
+class ReluGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    xla::XlaOp y = ctx->Input("y_0");
+    xla::XlaOp dy = ctx->Input("dy_0");
+    // dx = y > 0 ? dy : 0
+    ctx->SetOutput("dx_0", xla::Select(xla::Gt(y, xla::ScalarLike(y, 0)), dy,
+                                       xla::ZerosLike(dy)));
+  }
+};
+REGISTER_XLA_OP_KERNEL(relu_grad, ReluGradOp).Finalize();
+
 }  // namespace mola
 }  // namespace xrt
 }  // namespace oneflow
@@ -26,9 +26,6 @@ class AdamOptimizerOp : public OptimizerOp {
     xla::XlaOp weight = ctx->Input("model_0");
     xla::XlaOp m = ctx->Input("m_0");
     xla::XlaOp v = ctx->Input("v_0");
-    double scale_val = ctx->Attr<double>("scale");
-    float l1_val = ctx->Attr<float>("l1");
-    float l2_val = ctx->Attr<float>("l2");
     float beta1_val = ctx->Attr<float>("beta1");
     float beta2_val = ctx->Attr<float>("beta2");
     float epsilon_val = ctx->Attr<float>("epsilon");
@@ -38,7 +35,6 @@ class AdamOptimizerOp : public OptimizerOp {
     xla::XlaOp lr;
     xla::XlaOp beta1_t;
     xla::XlaOp beta2_t;
-    xla::XlaOp scale_by_tensor;
     if (do_bias_correction) {
       beta1_t = ctx->Input("beta1_t_0");
       beta2_t = ctx->Input("beta2_t_0");
@@ -46,42 +42,8 @@ class AdamOptimizerOp : public OptimizerOp {
     } else {
       lr = learning_rate;
     }
-    if (ctx->HasInput("scale_by_tensor_0")) {
-      scale_by_tensor = ctx->Input("scale_by_tensor_0");
-    }
-    Shape gradient_shape = ctx->InputShape("model_diff_0");
-    if (gradient_shape.NumAxes() > 1) {
-      std::vector<long long> bcast_sizes;
-      for (int i = 0; i < gradient_shape.NumAxes() - 1; ++i) {
-        bcast_sizes.emplace_back(gradient_shape.At(i));
-      }
-      lr = xla::Broadcast(lr, bcast_sizes);
-      if (ctx->HasInput("scale_by_tensor_0")) {
-        scale_by_tensor = xla::Broadcast(scale_by_tensor, bcast_sizes);
-      }
-    }
-    DataType model_dtype = ctx->InputType("model_0");
-    DataType gradient_dtype = ctx->InputType("model_diff_0");
-
-    if (model_dtype != gradient_dtype) {
-      xla::PrimitiveType data_type = DataTypeToPrimitiveType(model_dtype);
-      gradient = xla::ConvertElementType(gradient, data_type);
-    }
-    if (ctx->HasInput("scale_by_tensor_0")) {
-      gradient = gradient * scale_by_tensor;
-    }
-    if (scale_val != 1) {
-      xla::XlaOp scale = xla::ScalarLike(gradient, scale_val);
-      gradient = gradient * scale;
-    }
-    if (std::abs(l1_val) != 0) {
-      xla::XlaOp l1 = xla::ScalarLike(gradient, l1_val);
-      gradient = gradient + l1 * xla::Sign(weight);
-    }
-    if (std::abs(l2_val) != 0) {
-      xla::XlaOp l2 = xla::ScalarLike(gradient, l2_val);
-      gradient = gradient + l2 * weight;
-    }
+    lr = BroadcastToRank(lr, ctx->InputShape("model_diff_0"));
+    gradient = RegularizeGradient(ctx, gradient, weight);
 
     xla::XlaOp beta1 = xla::ScalarLike(m, beta1_val);
     xla::XlaOp beta2 = xla::ScalarLike(v, beta2_val);
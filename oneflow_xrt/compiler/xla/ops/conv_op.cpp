@@ -0,0 +1,259 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/xla/ops/op_context.h"
+#include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
+#include "oneflow_xrt/compiler/xla/ops/window_util.h"
+#include "oneflow_xrt/compiler/xla/xla_helpers.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+struct ConvParams {
+  DataLayout data_layout;
+  DataLayout filter_layout;
+  std::vector<long long> kernel_size;
+  std::vector<long long> strides;
+  std::vector<long long> dilation_rate;
+  std::vector<long long> padding_before;
+  int groups = 1;
+};
+
+static ConvParams GetConvParams(XlaOpContext* ctx, int num_axes) {
+  ConvParams params;
+  const std::string& data_format = ctx->Attr<std::string>("data_format");
+  params.data_layout = MakeDataLayout(data_format, num_axes);
+  params.filter_layout = MakeDataLayout(data_format, num_axes);
+
+  const auto& kernel_size = ctx->Attr<std::vector<int32_t>>("kernel_size");
+  const auto& strides = ctx->Attr<std::vector<int32_t>>("strides");
+  const auto& dilation = ctx->Attr<std::vector<int32_t>>("dilation_rate");
+  const auto& padding = ctx->Attr<std::vector<int32_t>>("padding_before");
+  params.kernel_size.assign(kernel_size.begin(), kernel_size.end());
+  params.strides.assign(strides.begin(), strides.end());
+  params.dilation_rate.assign(dilation.begin(), dilation.end());
+  params.padding_before.assign(padding.begin(), padding.end());
+  params.groups = ctx->Attr<int32_t>("groups");
+  return params;
+}
+
+// Dimension numbers for convolving a data tensor laid out as `data` with a
+// filter laid out as `filter`.
+static xla::ConvolutionDimensionNumbers MakeConvDimensionNumbers(
+    const DataLayout& data, const DataLayout& filter) {
+  xla::ConvolutionDimensionNumbers dnums;
+  dnums.set_input_batch_dimension(data.batch_dim);
+  dnums.set_input_feature_dimension(data.feature_dim);
+  dnums.set_output_batch_dimension(data.batch_dim);
+  dnums.set_output_feature_dimension(data.feature_dim);
+  dnums.set_kernel_output_feature_dimension(filter.batch_dim);
+  dnums.set_kernel_input_feature_dimension(filter.feature_dim);
+  for (int i = 0; i < data.spatial_dims.size(); ++i) {
+    dnums.add_input_spatial_dimensions(data.spatial_dims[i]);
+    dnums.add_output_spatial_dimensions(data.spatial_dims[i]);
+    dnums.add_kernel_spatial_dimensions(filter.spatial_dims[i]);
+  }
+  return dnums;
+}
+
+class ConvolutionOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+};
+
+void ConvolutionOp::Compile(XlaOpContext* ctx) {
+  Shape in_shape = ctx->InputShape("in_0");
+  ConvParams params = GetConvParams(ctx, in_shape.NumAxes());
+  int num_spatial_dims = params.data_layout.spatial_dims.size();
+
+  // OneFlow pads both sides with `padding_before`
+  std::vector<std::pair<long long, long long>> padding(num_spatial_dims);
+  for (int i = 0; i < num_spatial_dims; ++i) {
+    padding[i] = {params.padding_before[i], params.padding_before[i]};
+  }
+  std::vector<long long> lhs_dilation(num_spatial_dims, 1);
+  xla::XlaOp output = xla::ConvGeneralDilated(
+      ctx->Input("in_0"), ctx->Input("weight_0"), params.strides, padding,
+      lhs_dilation, params.dilation_rate,
+      MakeConvDimensionNumbers(params.data_layout, params.filter_layout),
+      params.groups);
+
+  if (ctx->HasInput("bias_0")) {
+    output = xla::Add(output, ctx->Input("bias_0"),
+                      {params.data_layout.feature_dim});
+  }
+  if (ctx->HasInput("_add_to_output_0")) {
+    output = xla::Add(output, ctx->Input("_add_to_output_0"));
+  }
+  ctx->SetOutput("out_0", output);
+}
+
+REGISTER_XLA_OP_KERNEL(conv1d, ConvolutionOp).Finalize();
+REGISTER_XLA_OP_KERNEL(conv2d, ConvolutionOp).Finalize();
+REGISTER_XLA_OP_KERNEL(conv3d, ConvolutionOp).Finalize();
+
+class ConvDataGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+
+ private:
+  // Rearranges filter [O, I/g, ...] to [O/g, I, ...] so that the data
+  // gradient is a grouped convolution of dy with the reversed filter.
+  xla::XlaOp SwapGroupedFeatures(const xla::XlaOp& filter,
+                                 const Shape& filter_shape,
+                                 const DataLayout& layout, int groups);
+};
+
+xla::XlaOp ConvDataGradOp::SwapGroupedFeatures(const xla::XlaOp& filter,
+                                               const Shape& filter_shape,
+                                               const DataLayout& layout,
+                                               int groups) {
+  if (groups == 1) {
+    return filter;
+  }
+  int num_axes = filter_shape.NumAxes();
+  // [O, ...] -> [g, O/g, ...]
+  std::vector<long long> split_dims{groups, filter_shape.At(0) / groups};
+  for (int i = 1; i < num_axes; ++i) {
+    split_dims.push_back(filter_shape.At(i));
+  }
+  xla::XlaOp output = xla::Reshape(filter, split_dims);
+  // Move the group dimension in front of the input feature dimension
+  std::vector<long long> permutation{1};
+  for (int i = 1; i < num_axes; ++i) {
+    if (i == layout.feature_dim) {
+      permutation.push_back(0);
+    }
+    permutation.push_back(i + 1);
+  }
+  output = xla::Transpose(output, permutation);
+
+  Shape shape = filter_shape;
+  shape.Set(0, filter_shape.At(0) / groups);
+  shape.Set(layout.feature_dim, filter_shape.At(layout.feature_dim) * groups);
+  return Reshape(output, shape);
+}
+
+void ConvDataGradOp::Compile(XlaOpContext* ctx) {
+  Shape dy_shape = ctx->InputShape("dy_0");
+  Shape x_shape = ctx->InputShape("x_like_0");
+  ConvParams params = GetConvParams(ctx, x_shape.NumAxes());
+  const DataLayout& layout = params.data_layout;
+  int num_spatial_dims = layout.spatial_dims.size();
+
+  xla::XlaOp filter =
+      SwapGroupedFeatures(ctx->Input("filter_0"), ctx->InputShape("filter_0"),
+                          params.filter_layout, params.groups);
+  filter = xla::Rev(filter, params.filter_layout.spatial_dims);
+
+  // dx is the convolution of dy dilated by strides with the reversed filter
+  std::vector<std::pair<long long, long long>> padding(num_spatial_dims);
+  for (int i = 0; i < num_spatial_dims; ++i) {
+    int64_t dim = layout.spatial_dims[i];
+    int64_t effective_kernel =
+        (params.kernel_size[i] - 1) * params.dilation_rate[i] + 1;
+    int64_t expanded_dy = (dy_shape.At(dim) - 1) * params.strides[i] + 1;
+    int64_t padded_dy = x_shape.At(dim) + effective_kernel - 1;
+    int64_t before = effective_kernel - 1 - params.padding_before[i];
+    padding[i] = {before, padded_dy - expanded_dy - before};
+  }
+  std::vector<long long> window_strides(num_spatial_dims, 1);
+
+  // Input and output features of the filter are swapped
+  DataLayout filter_layout = params.filter_layout;
+  std::swap(filter_layout.batch_dim, filter_layout.feature_dim);
+  xla::XlaOp dx = xla::ConvGeneralDilated(
+      ctx->Input("dy_0"), filter, window_strides, padding, params.strides,
+      params.dilation_rate, MakeConvDimensionNumbers(layout, filter_layout),
+      params.groups);
+  ctx->SetOutput("dx_0", dx);
+}
+
+REGISTER_XLA_OP_KERNEL(conv_data_grad, ConvDataGradOp).Finalize();
+
+class ConvFilterGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+};
+
+void ConvFilterGradOp::Compile(XlaOpContext* ctx) {
+  Shape dy_shape = ctx->InputShape("dy_0");
+  Shape x_shape = ctx->InputShape("x_0");
+  ConvParams params = GetConvParams(ctx, x_shape.NumAxes());
+  const DataLayout& layout = params.data_layout;
+  const DataLayout& filter_layout = params.filter_layout;
+  int num_spatial_dims = layout.spatial_dims.size();
+
+  // The filter gradient is the convolution of x with dy, where the batch
+  // dimension is contracted and each input channel yields one filter row.
+  xla::ConvolutionDimensionNumbers dnums;
+  dnums.set_input_batch_dimension(layout.feature_dim);
+  dnums.set_input_feature_dimension(layout.batch_dim);
+  dnums.set_kernel_input_feature_dimension(layout.batch_dim);
+  dnums.set_kernel_output_feature_dimension(layout.feature_dim);
+  dnums.set_output_batch_dimension(filter_layout.feature_dim);
+  dnums.set_output_feature_dimension(filter_layout.batch_dim);
+
+  std::vector<std::pair<long long, long long>> padding(num_spatial_dims);
+  for (int i = 0; i < num_spatial_dims; ++i) {
+    int64_t dim = layout.spatial_dims[i];
+    dnums.add_input_spatial_dimensions(dim);
+    dnums.add_kernel_spatial_dimensions(dim);
+    dnums.add_output_spatial_dimensions(filter_layout.spatial_dims[i]);
+
+    int64_t effective_kernel =
+        (params.kernel_size[i] - 1) * params.dilation_rate[i] + 1;
+    int64_t padded_x = (dy_shape.At(dim) - 1) * params.strides[i] +
+                       effective_kernel;
+    int64_t before = params.padding_before[i];
+    padding[i] = {before, padded_x - x_shape.At(dim) - before};
+  }
+  std::vector<long long> lhs_dilation(num_spatial_dims, 1);
+  xla::XlaOp filter_diff = xla::ConvGeneralDilated(
+      ctx->Input("x_0"), ctx->Input("dy_0"), params.dilation_rate, padding,
+      lhs_dilation, params.strides, dnums, /*feature_group_count=*/1,
+      /*batch_group_count=*/params.groups);
+  ctx->SetOutput("filter_diff_0", filter_diff);
+}
+
+REGISTER_XLA_OP_KERNEL(conv_filter_grad, ConvFilterGradOp).Finalize();
+
+class ConvBiasGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape dy_shape = ctx->InputShape("dy_0");
+    DataLayout layout = MakeDataLayout(ctx->Attr<std::string>("data_format"),
+                                       dy_shape.NumAxes());
+    std::vector<long long> reduce_dims;
+    for (int i = 0; i < dy_shape.NumAxes(); ++i) {
+      if (i != layout.feature_dim) {
+        reduce_dims.push_back(i);
+      }
+    }
+    DataType data_type = ctx->InputType("dy_0");
+    ctx->SetOutput("bias_diff_0",
+                   xla::Reduce(ctx->Input("dy_0"),
+                               Zero(ctx->builder(), data_type),
+                               CreateAddFunc(data_type), reduce_dims));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(conv_bias_grad, ConvBiasGradOp).Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
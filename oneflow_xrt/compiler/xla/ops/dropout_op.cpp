@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/xla/ops/op_context.h"
+#include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
+#include "oneflow_xrt/compiler/xla/xla_helpers.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+// Returns a mask which keeps each element with probability 1 - rate. The
+// random numbers are generated by XLA, so they don't follow the OneFlow
+// generator and seed, and the ops are only clustered if the clustering
+// option `cluster_random_ops` is set.
+static xla::XlaOp RandomMask(xla::XlaBuilder* builder, const Shape& shape,
+                             float rate) {
+  std::vector<long long> dims(shape.dim_vec().begin(), shape.dim_vec().end());
+  xla::XlaOp uniform =
+      xla::RngUniform(xla::ConstantR0<float>(builder, 0.f),
+                      xla::ConstantR0<float>(builder, 1.f),
+                      xla::ShapeUtil::MakeShape(xla::F32, dims));
+  return xla::Ge(uniform, xla::ScalarLike(uniform, rate));
+}
+
+class DropoutOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape shape = ctx->InputShape("in_0");
+    float rate = ctx->Attr<float>("rate");
+    xla::XlaOp input = ctx->Input("in_0");
+    xla::XlaOp mask = RandomMask(ctx->builder(), shape, rate);
+
+    float scale = rate < 1.f ? 1.f / (1.f - rate) : 0.f;
+    xla::XlaOp output = xla::Select(mask, input * xla::ScalarLike(input, scale),
+                                    xla::ZerosLike(input));
+    if (ctx->HasInput("_add_to_output_0")) {
+      output = output + ctx->Input("_add_to_output_0");
+    }
+    ctx->SetOutput("out_0", output);
+    if (ctx->HasOutput("mask_0")) {
+      xla::PrimitiveType type =
+          DataTypeToPrimitiveType(ctx->OutputType("mask_0"));
+      ctx->SetOutput("mask_0", xla::ConvertElementType(mask, type));
+    }
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(dropout, DropoutOp).Finalize();
+
+class DropoutGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    xla::XlaOp dy = ctx->Input("dy_0");
+    xla::XlaOp mask = ctx->Input("mask_0");
+    xla::XlaOp scale = xla::ScalarLike(dy, ctx->Attr<float>("scale"));
+    xla::XlaOp keep = xla::Ne(mask, xla::ZerosLike(mask));
+    ctx->SetOutput("dx_0", xla::Select(keep, dy * scale, xla::ZerosLike(dy)));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(dropout_grad, DropoutGradOp).Finalize();
+
+class RandomMaskLikeOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    xla::XlaOp mask = RandomMask(ctx->builder(), ctx->InputShape("like_0"),
+                                 ctx->Attr<float>("rate"));
+    xla::PrimitiveType type = DataTypeToPrimitiveType(ctx->OutputType("out_0"));
+    ctx->SetOutput("out_0", xla::ConvertElementType(mask, type));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(random_mask_like, RandomMaskLikeOp).Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
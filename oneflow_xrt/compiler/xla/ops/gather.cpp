@@ -13,6 +13,11 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <algorithm>
+#include <numeric>
+
+#include "oneflow_xrt/common/env.h"
+#include "oneflow_xrt/common/shape_util.h"
 #include "oneflow_xrt/compiler/xla/ops/op_context.h"
 #include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
 #include "oneflow_xrt/compiler/xla/xla_helpers.h"
@@ -53,6 +58,7 @@ xla::XlaOp GenericGather(const xla::XlaOp& input, const xla::XlaOp& indices,
 
   return xla::Gather(input, indices, dim_numbers, slice_sizes);
 }
+
 xla::XlaOp GenericGatherGrad(
     const xla::XlaOp& buffer, const xla::XlaOp& updates,
     const xla::XlaOp& indices, bool indices_are_vectors,
@@ -179,6 +185,235 @@ class BatchGatherOp : public GatherOp {
 REGISTER_XLA_OP_KERNEL(gather, GatherOp).Finalize();
 REGISTER_XLA_OP_KERNEL(batch_gather, BatchGatherOp).Finalize();
 
+class EmbeddingOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    ctx->SetOutput("out_0", GenericGather(ctx->Input("weight_0"),
+                                          ctx->Input("indices_0"),
+                                          ctx->InputShape("weight_0"),
+                                          ctx->InputShape("indices_0"), 0));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(embedding, EmbeddingOp).Finalize();
+
+// Scatter-add is the fastest way to sum the segments, but it's lowered to
+// atomic adds on GPU which are not deterministic. The one-hot strategy sums the
+// segments by a matmul with the one-hot encoding of the ids instead, which is
+// deterministic on all devices.
+static bool UseOneHotSegmentSum(const XrtDevice& device) {
+  static bool deterministic =
+      EnvToBool(ONEFLOW_XRT_XLA_DETERMINISTIC_SCATTER, false);
+  return deterministic && device == XrtDevice::GPU_CUDA;
+}
+
+struct SegmentSumParam {
+  // data layout [batch, ids..., inner...], ids layout [batch, ids...]. The
+  // batch dimension is optional.
+  Shape data_shape;
+  Shape ids_shape;
+  bool has_batch = false;
+  int64_t num_segments;
+  DataType data_type;
+  DataType ids_type;
+};
+
+// Returns the sum of `data` over the rows sharing the same segment id, with
+// layout [batch, num_segments, inner...]. The out-of-range ids are ignored.
+static xla::XlaOp SegmentSum(XlaOpContext* ctx, const xla::XlaOp& data,
+                             const xla::XlaOp& segment_ids,
+                             const SegmentSumParam& param) {
+  xla::XlaBuilder* builder = ctx->builder();
+  const Shape& data_shape = param.data_shape;
+  const Shape& ids_shape = param.ids_shape;
+  int64_t batch_size = param.has_batch ? ids_shape.At(0) : 1;
+  int64_t num_ids = ids_shape.elem_cnt() / batch_size;
+  int64_t inner_size = data_shape.Count(ids_shape.NumAxes());
+  xla::PrimitiveType ids_type = DataTypeToPrimitiveType(param.ids_type);
+
+  std::vector<long long> out_dims{param.num_segments};
+  for (int i = ids_shape.NumAxes(); i < data_shape.NumAxes(); ++i) {
+    out_dims.push_back(data_shape.At(i));
+  }
+  if (param.has_batch) {
+    out_dims.insert(out_dims.begin(), batch_size);
+  }
+
+  // Flatten to ids [B, K] and data [B, K, R]
+  xla::XlaOp ids = xla::Reshape(segment_ids, {batch_size, num_ids});
+  xla::XlaOp values = xla::Reshape(data, {batch_size, num_ids, inner_size});
+  if (UseOneHotSegmentSum(ctx->device())) {
+    // one_hot [B, S, K] x data [B, K, R] -> [B, S, R]
+    std::vector<long long> one_hot_dims{batch_size, param.num_segments,
+                                        num_ids};
+    xla::XlaOp one_hot = xla::Eq(
+        xla::Iota(builder, xla::ShapeUtil::MakeShape(ids_type, one_hot_dims),
+                  1),
+        xla::BroadcastInDim(ids, one_hot_dims, {0, 2}));
+    one_hot = xla::ConvertElementType(
+        one_hot, DataTypeToPrimitiveType(param.data_type));
+    xla::DotDimensionNumbers dnums;
+    dnums.add_lhs_batch_dimensions(0);
+    dnums.add_rhs_batch_dimensions(0);
+    dnums.add_lhs_contracting_dimensions(2);
+    dnums.add_rhs_contracting_dimensions(1);
+    return xla::Reshape(xla::DotGeneral(one_hot, values, dnums), out_dims);
+  }
+
+  // Scatter by the index vectors (batch, id) with layout [B, K, 2]
+  std::vector<long long> index_dims{batch_size, num_ids, 1};
+  xla::XlaOp batch_index = xla::Iota(
+      builder, xla::ShapeUtil::MakeShape(ids_type, index_dims), 0);
+  xla::XlaOp indices = xla::ConcatInDim(
+      builder, {batch_index, xla::Reshape(ids, index_dims)}, 2);
+  xla::XlaOp buffer =
+      Zeros(builder, Shape({batch_size, param.num_segments, inner_size}),
+            param.data_type);
+  xla::XlaOp output = GenericGatherGrad(
+      buffer, values, indices, /*indices_are_vectors=*/true,
+      [](xla::XlaOp x, xla::XlaOp y, xla::XlaBuilder*) { return x + y; },
+      builder);
+  return xla::Reshape(output, out_dims);
+}
+
+class UnsortedSegmentSumOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+
+  virtual int64_t NumSegments(XlaOpContext* ctx, int64_t axis) const {
+    return ctx->Attr<int64_t>("num_segments");
+  }
+};
+
+void UnsortedSegmentSumOp::Compile(XlaOpContext* ctx) {
+  Shape data_shape = ctx->InputShape("data_0");
+  Shape ids_shape = ctx->InputShape("segment_ids_0");
+  int64_t axis = ctx->Attr<int64_t>("axis");
+  int64_t num_ids_dims = ids_shape.NumAxes();
+
+  // Move the segmented dimensions to the front, [ids..., outer..., inner...]
+  std::vector<long long> permutation;
+  for (int64_t i = axis; i < axis + num_ids_dims; ++i) {
+    permutation.push_back(i);
+  }
+  for (int64_t i = 0; i < data_shape.NumAxes(); ++i) {
+    if (i < axis || i >= axis + num_ids_dims) {
+      permutation.push_back(i);
+    }
+  }
+  SegmentSumParam param;
+  param.data_shape = data_shape;
+  for (int i = 0; i < permutation.size(); ++i) {
+    param.data_shape.Set(i, data_shape.At(permutation[i]));
+  }
+  param.ids_shape = ids_shape;
+  param.num_segments = NumSegments(ctx, axis);
+  param.data_type = ctx->InputType("data_0");
+  param.ids_type = ctx->InputType("segment_ids_0");
+
+  xla::XlaOp data = ctx->Input("data_0");
+  if (axis > 0) {
+    data = xla::Transpose(data, permutation);
+  }
+  // [num_segments, outer..., inner...] -> [outer..., num_segments, inner...]
+  xla::XlaOp output = SegmentSum(ctx, data, ctx->Input("segment_ids_0"), param);
+  if (axis > 0) {
+    std::vector<long long> restore(data_shape.NumAxes() - num_ids_dims + 1);
+    std::iota(restore.begin(), restore.end(), 0);
+    std::rotate(restore.begin(), restore.begin() + 1,
+                restore.begin() + axis + 1);
+    output = xla::Transpose(output, restore);
+  }
+  ctx->SetOutput("out_0", output);
+}
+
+class UnsortedSegmentSumLikeOp : public UnsortedSegmentSumOp {
+ public:
+  int64_t NumSegments(XlaOpContext* ctx, int64_t axis) const override {
+    return ctx->InputShape("like_0").At(axis);
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(unsorted_segment_sum, UnsortedSegmentSumOp).Finalize();
+REGISTER_XLA_OP_KERNEL(unsorted_segment_sum_like, UnsortedSegmentSumLikeOp)
+    .Finalize();
+
+class UnsortedBatchSegmentSumOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape data_shape = ctx->InputShape("data_0");
+    Shape ids_shape = ctx->InputShape("segment_ids_0");
+    int64_t num_batch_dims = ids_shape.NumAxes() - 1;
+
+    // Flatten the batch dimensions, data [B, K, inner...] and ids [B, K]
+    SegmentSumParam param;
+    param.has_batch = true;
+    int64_t batch_size = ids_shape.Count(0, num_batch_dims);
+    std::vector<int64_t> data_dims{batch_size};
+    for (int64_t i = num_batch_dims; i < data_shape.NumAxes(); ++i) {
+      data_dims.push_back(data_shape.At(i));
+    }
+    param.data_shape = AsShape(data_dims);
+    param.ids_shape = Shape({batch_size, ids_shape.At(num_batch_dims)});
+    param.num_segments = ctx->Attr<int64_t>("num_segments");
+    param.data_type = ctx->InputType("data_0");
+    param.ids_type = ctx->InputType("segment_ids_0");
+
+    xla::XlaOp data = Reshape(ctx->Input("data_0"), param.data_shape);
+    xla::XlaOp ids = Reshape(ctx->Input("segment_ids_0"), param.ids_shape);
+    ctx->SetOutput("out_0", Reshape(SegmentSum(ctx, data, ids, param),
+                                    ctx->OutputShape("out_0")));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(unsorted_batch_segment_sum, UnsortedBatchSegmentSumOp)
+    .Finalize();
+
+// The fused embedding backward, which scatters dy into the rows of weight.
+class EmbeddingGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape weight_shape = ctx->InputShape("weight_0");
+    Shape ids_shape = ctx->InputShape("indices_0");
+    xla::XlaOp indices = ctx->Input("indices_0");
+    xla::XlaOp dy = ctx->Input("dy_0");
+
+    SegmentSumParam param;
+    param.data_shape = ctx->InputShape("dy_0");
+    param.ids_shape = ids_shape;
+    param.num_segments = weight_shape.At(0);
+    param.data_type = ctx->InputType("dy_0");
+    param.ids_type = ctx->InputType("indices_0");
+
+    std::vector<long long> ids_dims(ids_shape.NumAxes());
+    std::iota(ids_dims.begin(), ids_dims.end(), 0);
+    if (ctx->Attr<bool>("scale_grad_by_freq")) {
+      // Scale dy by the reciprocal of the frequency of its index
+      SegmentSumParam count_param = param;
+      count_param.data_shape = ids_shape;
+      xla::XlaOp ones = Ones(ctx->builder(), ids_shape, param.data_type);
+      xla::XlaOp counts = Reshape(SegmentSum(ctx, ones, indices, count_param),
+                                  Shape({param.num_segments, 1}));
+      counts = GenericGather(counts, indices, Shape({param.num_segments, 1}),
+                             ids_shape, 0);
+      dy = xla::Div(dy, Reshape(counts, ids_shape), ids_dims);
+    }
+    xla::XlaOp dx = SegmentSum(ctx, dy, indices, param);
+
+    int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    if (padding_idx >= 0) {
+      // The row of padding_idx never receives gradient
+      xla::XlaOp rows = xla::Iota(ctx->builder(), xla::S64, weight_shape.At(0));
+      xla::XlaOp mask = xla::Ne(rows, xla::ScalarLike(rows, padding_idx));
+      xla::PrimitiveType type = DataTypeToPrimitiveType(param.data_type);
+      dx = xla::Mul(dx, xla::ConvertElementType(mask, type), {0});
+    }
+    ctx->SetOutput("dx_0", dx);
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(embedding_grad, EmbeddingGradOp).Finalize();
+
 }  // namespace mola
 }  // namespace xrt
 }  // namespace oneflow
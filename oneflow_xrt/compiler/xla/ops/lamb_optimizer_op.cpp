@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+
+#include "oneflow_xrt/compiler/xla/ops/optimizer_op.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+class LambOptimizerOp : public OptimizerOp {
+ private:
+  void ApplyUpdate(XlaOpContext* ctx, xla::XlaOp gradient,
+                   xla::XlaOp learning_rate) override;
+
+  // Returns the l2 norm of `x` as a scalar
+  xla::XlaOp Norm(XlaOpContext* ctx, xla::XlaOp x) {
+    DataType data_type = ctx->InputType("model_0");
+    Shape shape = ctx->InputShape("model_0");
+    std::vector<long long> dims(shape.NumAxes());
+    std::iota(dims.begin(), dims.end(), 0);
+    return xla::Sqrt(xla::Reduce(x * x, Zero(ctx->builder(), data_type),
+                                 CreateAddFunc(data_type), dims));
+  }
+};
+
+void LambOptimizerOp::ApplyUpdate(XlaOpContext* ctx, xla::XlaOp gradient,
+                                  xla::XlaOp learning_rate) {
+  xla::XlaOp weight = ctx->Input("model_0");
+  xla::XlaOp m = ctx->Input("m_0");
+  xla::XlaOp v = ctx->Input("v_0");
+  float beta1_val = ctx->Attr<float>("beta1");
+  float beta2_val = ctx->Attr<float>("beta2");
+  float epsilon_val = ctx->Attr<float>("epsilon");
+  float weight_decay_val = ctx->Attr<float>("weight_decay");
+  gradient = RegularizeGradient(ctx, gradient, weight);
+
+  xla::XlaOp one = xla::ScalarLike(m, 1.f);
+  xla::XlaOp beta1 = xla::ScalarLike(m, beta1_val);
+  xla::XlaOp beta2 = xla::ScalarLike(v, beta2_val);
+  m = beta1 * m + (one - beta1) * gradient;
+  v = beta2 * v + (one - beta2) * gradient * gradient;
+  ctx->SetOutput("m_0", m);
+  ctx->SetOutput("v_0", v);
+
+  xla::XlaOp m_hat = m;
+  xla::XlaOp v_hat = v;
+  bool do_bias_correction = ctx->HasInput("beta1_t_0");
+  if (do_bias_correction) {
+    Shape shape = ctx->InputShape("model_0");
+    xla::XlaOp beta1_t = ctx->Input("beta1_t_0");
+    xla::XlaOp beta2_t = ctx->Input("beta2_t_0");
+    m_hat = m / BroadcastToRank(xla::ScalarLike(beta1_t, 1.f) - beta1_t, shape);
+    v_hat = v / BroadcastToRank(xla::ScalarLike(beta2_t, 1.f) - beta2_t, shape);
+    ctx->SetOutput("beta1_t_0", beta1_t * xla::ScalarLike(beta1_t, beta1_val));
+    ctx->SetOutput("beta2_t_0", beta2_t * xla::ScalarLike(beta2_t, beta2_val));
+  }
+  xla::XlaOp epsilon = xla::ScalarLike(v, epsilon_val);
+  xla::XlaOp weight_decay = xla::ScalarLike(weight, weight_decay_val);
+  xla::XlaOp update =
+      m_hat / (xla::Sqrt(v_hat) + epsilon) + weight_decay * weight;
+
+  // trust_ratio = ||w|| / ||update|| if both norms are positive, otherwise 1
+  xla::XlaOp weight_norm = Norm(ctx, weight);
+  xla::XlaOp update_norm = Norm(ctx, update);
+  xla::XlaOp zero = xla::ZerosLike(weight_norm);
+  xla::XlaOp is_positive =
+      xla::And(xla::Gt(weight_norm, zero), xla::Gt(update_norm, zero));
+  xla::XlaOp trust_ratio =
+      xla::Select(is_positive, weight_norm / update_norm,
+                  xla::ScalarLike(weight_norm, 1.f));
+
+  xla::XlaOp lr = learning_rate * trust_ratio;
+  lr = BroadcastToRank(lr, ctx->InputShape("model_diff_0"));
+  ctx->SetOutput("model_0", weight - lr * update);
+}
+
+REGISTER_XLA_OP_KERNEL(lamb_update, LambOptimizerOp)
+    .MarkModelUpdateOp()
+    .SetMutableVariables({"model_0", "m_0", "v_0", "beta1_t_0", "beta2_t_0"})
+    .Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
@@ -29,16 +29,36 @@ class LayerNormOp : public XlaOpKernel {
   void Compile(XlaOpContext* ctx) override;
 
  private:
-  xla::XlaOp BatchNormTraining(const xla::XlaOp& input, const xla::XlaOp& scale,
-                               const xla::XlaOp& shift, double epsilon) {
-    // Feature index is 1 for NCHW
-    int feature_index = 1;
-    return xla::BatchNormTraining(input, scale, shift, epsilon, feature_index);
-  }
+  // Merges two partial (count, mean, m2) moments of Welford's algorithm by the
+  // parallel formula of Chan et al., where m2 is the sum of squared
+  // differences from the mean.
+  xla::XlaComputation CreateWelfordFunc(xla::PrimitiveType type);
 };
 
+xla::XlaComputation LayerNormOp::CreateWelfordFunc(xla::PrimitiveType type) {
+  xla::XlaBuilder builder("Welford.template");
+  xla::Shape scalar_shape = xla::ShapeUtil::MakeShape(type, {});
+  auto count_a = xla::Parameter(&builder, 0, scalar_shape, "count_a");
+  auto mean_a = xla::Parameter(&builder, 1, scalar_shape, "mean_a");
+  auto m2_a = xla::Parameter(&builder, 2, scalar_shape, "m2_a");
+  auto count_b = xla::Parameter(&builder, 3, scalar_shape, "count_b");
+  auto mean_b = xla::Parameter(&builder, 4, scalar_shape, "mean_b");
+  auto m2_b = xla::Parameter(&builder, 5, scalar_shape, "m2_b");
+
+  auto count = count_a + count_b;
+  auto delta = mean_b - mean_a;
+  // Both of the partial counts are zero when merging the init values
+  auto ratio = count_b / xla::Max(count, xla::ScalarLike(count, 1.f));
+  auto mean = mean_a + delta * ratio;
+  auto m2 = m2_a + m2_b + delta * delta * count_a * ratio;
+  xla::Tuple(&builder, {count, mean, m2});
+  return builder.Build().ConsumeValueOrDie();
+}
+
+// Mean and variance are computed by a single Welford reduction over the
+// normalized dimensions, and the normalization, scale and shift are fused
+// into one elementwise pass. Half precision inputs are accumulated in fp32.
 void LayerNormOp::Compile(XlaOpContext* ctx) {
-  // input layout [N, C, H, W]
   Shape input_shape = ctx->InputShape("x_0");
 
   int begin_norm_axis = ctx->Attr<int64_t>("begin_norm_axis");
@@ -50,58 +70,60 @@ void LayerNormOp::Compile(XlaOpContext* ctx) {
   }
 
   DataType data_type = ctx->InputType("x_0");
-  if (ctx->HasOutput("mean_0")) {
-    data_type = ctx->OutputType("mean_0");
-  }
+  xla::PrimitiveType compute_type =
+      DataTypeToPrimitiveType(AccumulationType(data_type));
   int64_t batch_dims = input_shape.Count(0, begin_norm_axis);
   int64_t norm_dims = input_shape.Count(begin_norm_axis);
-  Shape bn_shape = Shape({1, batch_dims, 1, norm_dims});
-  Shape scale_shape = Shape({batch_dims});
-  // Ones and zeros layout [N]
-  xla::XlaOp ones = Ones(ctx->builder(), scale_shape, data_type);
-  xla::XlaOp zeros = Zeros(ctx->builder(), scale_shape, data_type);
-  // input layout [1, N, 1, CHW]
-  xla::XlaOp input = Reshape(ctx->Input("x_0"), bn_shape);
-
-  // FP16 batch normalization (cudnn style) has not been supported by XLA.
-  if (ctx->InputType("x_0") != data_type) {
-    input = xla::ConvertElementType(input, DataTypeToPrimitiveType(data_type));
-  }
+  // input layout [N, CHW]
+  xla::XlaOp input = Reshape(ctx->Input("x_0"), Shape({batch_dims, norm_dims}));
+  input = xla::ConvertElementType(input, compute_type);
+
+  xla::XlaBuilder* builder = ctx->builder();
+  xla::XlaOp zero = xla::Zero(builder, compute_type);
+  xla::XlaOp ones =
+      xla::Broadcast(xla::One(builder, compute_type), {batch_dims, norm_dims});
+  xla::XlaOp moments =
+      xla::Reduce(builder, {ones, input, xla::ZerosLike(input)},
+                  {zero, zero, zero}, CreateWelfordFunc(compute_type), {1});
+  xla::XlaOp mean = xla::GetTupleElement(moments, 1);
+  xla::XlaOp variance = xla::GetTupleElement(moments, 2) /
+                        xla::ScalarLike(mean, static_cast<double>(norm_dims));
 
   double epsilon = ctx->Attr<double>("epsilon");
-  // BatchNorm
-  xla::XlaOp norm_output = BatchNormTraining(input, ones, zeros, epsilon);
-  // Set outputs, scale and shift
-  xla::XlaOp output = xla::GetTupleElement(norm_output, 0);
-  xla::XlaOp mean = xla::GetTupleElement(norm_output, 1);
-  xla::XlaOp variance = xla::GetTupleElement(norm_output, 2);
   xla::XlaOp inv_variance =
-      xla::Rsqrt(xla::Add(variance, xla::ScalarLike(variance, epsilon)));
+      xla::Rsqrt(variance + xla::ScalarLike(variance, epsilon));
 
   Shape mean_shape = SliceShape(input_shape, 0, begin_norm_axis);
   if (ctx->HasOutput("mean_0")) {
-    ctx->SetOutput("mean_0", Reshape(mean, mean_shape));
+    xla::PrimitiveType type =
+        DataTypeToPrimitiveType(ctx->OutputType("mean_0"));
+    ctx->SetOutput("mean_0",
+                   Reshape(xla::ConvertElementType(mean, type), mean_shape));
   }
   if (ctx->HasOutput("inv_variance_0")) {
-    ctx->SetOutput("inv_variance_0", Reshape(inv_variance, mean_shape));
-  }
-
-  if (ctx->OutputType("y_0") != data_type) {
-    DataType output_type = ctx->OutputType("y_0");
-    output =
-        xla::ConvertElementType(output, DataTypeToPrimitiveType(output_type));
+    xla::PrimitiveType type =
+        DataTypeToPrimitiveType(ctx->OutputType("inv_variance_0"));
+    ctx->SetOutput("inv_variance_0",
+                   Reshape(xla::ConvertElementType(inv_variance, type),
+                           mean_shape));
   }
 
+  xla::XlaOp output = xla::Mul(xla::Sub(input, mean, {0} /*broadcast dim*/),
+                               inv_variance, {0} /*broadcast dim*/);
   Shape param_shape = Shape({norm_dims});
   if (ctx->Attr<bool>("scale")) {
-    output = xla::Mul(output, Reshape(ctx->Input("gamma_0"), param_shape),
-                      {3} /*broadcast dim*/);
+    xla::XlaOp gamma = Reshape(ctx->Input("gamma_0"), param_shape);
+    output = xla::Mul(output, xla::ConvertElementType(gamma, compute_type),
+                      {1} /*broadcast dim*/);
   }
   if (ctx->Attr<bool>("center")) {
-    output = xla::Add(output, Reshape(ctx->Input("beta_0"), param_shape),
-                      {3} /*broadcast dim*/);
+    xla::XlaOp beta = Reshape(ctx->Input("beta_0"), param_shape);
+    output = xla::Add(output, xla::ConvertElementType(beta, compute_type),
+                      {1} /*broadcast dim*/);
   }
-
+  DataType output_type = ctx->OutputType("y_0");
+  output =
+      xla::ConvertElementType(output, DataTypeToPrimitiveType(output_type));
   ctx->SetOutput("y_0", Reshape(output, input_shape));
 }
 
@@ -148,27 +170,25 @@ void LayerNormGradOp::Compile(XlaOpContext* ctx) {
   mean = Reshape(mean, scale_shape);
   variance = Reshape(variance, scale_shape);
   output_grad = Reshape(output_grad, bn_shape);
+  // Compute the gradient in float if the activation is float16 or bfloat16.
+  DataType data_type = ctx->InputType("x_0");
+  xla::PrimitiveType compute_type =
+      DataTypeToPrimitiveType(AccumulationType(data_type));
+  activation = xla::ConvertElementType(activation, compute_type);
+  output_grad = xla::ConvertElementType(output_grad, compute_type);
   if (ctx->HasInput("gamma_0")) {
-    xla::XlaOp gamma = ctx->Input("gamma_0");
+    xla::XlaOp gamma =
+        xla::ConvertElementType(ctx->Input("gamma_0"), compute_type);
     output_grad = xla::Mul(output_grad, gamma, {3} /*broadcast dim*/);
   }
-  if (ctx->InputType("mean_0") != ctx->InputType("x_0")) {
-    DataType data_type = ctx->InputType("mean_0");
-    activation =
-        xla::ConvertElementType(activation, DataTypeToPrimitiveType(data_type));
-    output_grad = xla::ConvertElementType(output_grad,
-                                          DataTypeToPrimitiveType(data_type));
-  }
+  mean = xla::ConvertElementType(mean, compute_type);
+  variance = xla::ConvertElementType(variance, compute_type);
+  ones = xla::ConvertElementType(ones, compute_type);
 
   auto output = BatchNormGrad(activation, xla::Broadcast(ones, {batch_dims}),
                               mean, variance, output_grad, epsilon);
-  xla::XlaOp activation_grad = xla::GetTupleElement(output, 0);
-
-  if (ctx->InputType("mean_0") != ctx->InputType("x_0")) {
-    DataType data_type = ctx->InputType("x_0");
-    activation_grad = xla::ConvertElementType(
-        activation_grad, DataTypeToPrimitiveType(data_type));
-  }
+  xla::XlaOp activation_grad = xla::ConvertElementType(
+      xla::GetTupleElement(output, 0), DataTypeToPrimitiveType(data_type));
   ctx->SetOutput("dx_0", Reshape(activation_grad, activation_shape));
 }
 
@@ -190,24 +210,32 @@ void LayerNormParamGradOp::Compile(XlaOpContext* ctx) {
 
   xla::XlaBuilder* builder = ctx->builder();
   DataType data_type = ctx->InputType("dy_0");
-  xla::XlaComputation add_func = CreateAddFunc(data_type);
+  // Accumulate by float if the gradient is float16 or bfloat16.
+  DataType compute_type = AccumulationType(data_type);
+  xla::PrimitiveType type = DataTypeToPrimitiveType(compute_type);
+  xla::PrimitiveType output_type = DataTypeToPrimitiveType(data_type);
+  output_grad = xla::ConvertElementType(output_grad, type);
+  xla::XlaComputation add_func = CreateAddFunc(compute_type);
   if (ctx->HasOutput("beta_diff_0")) {
-    xla::XlaOp beta_grad = xla::Reduce(output_grad, Zero(builder, data_type),
-                                       add_func, batch_dims);
-    ctx->SetOutput("beta_diff_0", beta_grad);
+    xla::XlaOp beta_grad = xla::Reduce(
+        output_grad, Zero(builder, compute_type), add_func, batch_dims);
+    ctx->SetOutput("beta_diff_0",
+                   xla::ConvertElementType(beta_grad, output_type));
   }
-  xla::XlaOp x = ctx->Input("x_0");
-  xla::XlaOp mean = ctx->Input("mean_0");
-  xla::XlaOp inv_variance = ctx->Input("inv_variance_0");
+  xla::XlaOp x = xla::ConvertElementType(ctx->Input("x_0"), type);
+  xla::XlaOp mean = xla::ConvertElementType(ctx->Input("mean_0"), type);
+  xla::XlaOp inv_variance =
+      xla::ConvertElementType(ctx->Input("inv_variance_0"), type);
   if (ctx->HasOutput("gamma_diff_0")) {
     // begin_params_axis is assumed equal to begin_norm_axis
     xla::XlaOp gamma_grad =
         xla::Mul(xla::Sub(x, mean, batch_dims /*broadcast dim*/), inv_variance,
                  batch_dims /*broadcast dim*/) *
         output_grad;
-    gamma_grad =
-        xla::Reduce(gamma_grad, Zero(builder, data_type), add_func, batch_dims);
-    ctx->SetOutput("gamma_diff_0", gamma_grad);
+    gamma_grad = xla::Reduce(gamma_grad, Zero(builder, compute_type),
+                             add_func, batch_dims);
+    ctx->SetOutput("gamma_diff_0",
+                   xla::ConvertElementType(gamma_grad, output_type));
   }
 }
 
@@ -0,0 +1,164 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+
+#include "oneflow_xrt/compiler/xla/ops/op_context.h"
+#include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
+#include "oneflow_xrt/compiler/xla/xla_helpers.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/math.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+static int GetFeatureIndex(XlaOpContext* ctx, const Shape& shape) {
+  int axis = ctx->Attr<int32_t>("axis");
+  if (axis < 0) {
+    axis += shape.NumAxes();
+  }
+  CHECK_GE(axis, 0);
+  CHECK_LT(axis, shape.NumAxes());
+  return axis;
+}
+
+class NormalizationOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+};
+
+void NormalizationOp::Compile(XlaOpContext* ctx) {
+  Shape in_shape = ctx->InputShape("x_0");
+  int feature_index = GetFeatureIndex(ctx, in_shape);
+  float epsilon = ctx->Attr<float>("epsilon");
+
+  // FP16 batch normalization (cudnn style) has not been supported by XLA, so
+  // normalize in the data type of the parameters.
+  DataType data_type = ctx->InputType("x_0");
+  DataType param_type = ctx->InputType("gamma_0");
+  xla::XlaOp input = ctx->Input("x_0");
+  if (data_type != param_type) {
+    input =
+        xla::ConvertElementType(input, DataTypeToPrimitiveType(param_type));
+  }
+  xla::XlaOp gamma = ctx->Input("gamma_0");
+  xla::XlaOp beta = ctx->Input("beta_0");
+
+  xla::XlaOp output;
+  if (ctx->Attr<bool>("training")) {
+    xla::XlaOp norm_output =
+        xla::BatchNormTraining(input, gamma, beta, epsilon, feature_index);
+    output = xla::GetTupleElement(norm_output, 0);
+    xla::XlaOp mean = xla::GetTupleElement(norm_output, 1);
+    xla::XlaOp variance = xla::GetTupleElement(norm_output, 2);
+    if (ctx->HasOutput("mean_0")) {
+      ctx->SetOutput("mean_0", mean);
+    }
+    if (ctx->HasOutput("inv_variance_0")) {
+      xla::XlaOp inv_variance =
+          xla::Rsqrt(variance + xla::ScalarLike(variance, epsilon));
+      ctx->SetOutput("inv_variance_0", inv_variance);
+    }
+    if (ctx->HasInput("moving_mean_0")) {
+      // Update the moving statistics in place, the moving variance tracks the
+      // unbiased batch variance.
+      xla::XlaOp momentum =
+          xla::ScalarLike(mean, ctx->Attr<float>("momentum"));
+      xla::XlaOp one = xla::ScalarLike(mean, 1.f);
+      int64_t count = in_shape.elem_cnt() / in_shape.At(feature_index);
+      double correction =
+          static_cast<double>(count) / std::max<int64_t>(count - 1, 1);
+      xla::XlaOp unbiased_variance =
+          variance * xla::ScalarLike(variance, correction);
+
+      xla::XlaOp moving_mean = ctx->Input("moving_mean_0");
+      xla::XlaOp moving_variance = ctx->Input("moving_variance_0");
+      ctx->SetOutput("moving_mean_0",
+                     moving_mean * momentum + mean * (one - momentum));
+      ctx->SetOutput("moving_variance_0",
+                     moving_variance * momentum +
+                         unbiased_variance * (one - momentum));
+    }
+  } else {
+    output = xla::BatchNormInference(
+        input, gamma, beta, ctx->Input("moving_mean_0"),
+        ctx->Input("moving_variance_0"), epsilon, feature_index);
+  }
+
+  if (data_type != param_type) {
+    output =
+        xla::ConvertElementType(output, DataTypeToPrimitiveType(data_type));
+  }
+  if (ctx->HasInput("_add_to_output_0")) {
+    output = xla::Add(output, ctx->Input("_add_to_output_0"));
+  }
+  ctx->SetOutput("y_0", output);
+}
+
+REGISTER_XLA_OP_KERNEL(normalization, NormalizationOp)
+    .SetMutableVariables({"moving_mean_0", "moving_variance_0"})
+    .Finalize();
+
+class NormalizationGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+};
+
+void NormalizationGradOp::Compile(XlaOpContext* ctx) {
+  Shape in_shape = ctx->InputShape("x_0");
+  int feature_index = GetFeatureIndex(ctx, in_shape);
+  float epsilon = ctx->Attr<float>("epsilon");
+
+  DataType data_type = ctx->InputType("x_0");
+  DataType param_type = ctx->InputType("gamma_0");
+  xla::XlaOp activation = ctx->Input("x_0");
+  xla::XlaOp output_grad = ctx->Input("dy_0");
+  if (data_type != param_type) {
+    xla::PrimitiveType type = DataTypeToPrimitiveType(param_type);
+    activation = xla::ConvertElementType(activation, type);
+    output_grad = xla::ConvertElementType(output_grad, type);
+  }
+
+  xla::XlaOp inv_variance = ctx->Input("inv_variance_0");
+  xla::XlaOp ones = xla::ScalarLike(inv_variance, 1.f);
+  xla::XlaOp variance = xla::Sub(ones / (inv_variance * inv_variance),
+                                 xla::ScalarLike(inv_variance, epsilon));
+  xla::XlaOp output = xla::BatchNormGrad(
+      activation, ctx->Input("gamma_0"), ctx->Input("mean_0"), variance,
+      output_grad, epsilon, feature_index);
+
+  xla::XlaOp activation_grad = xla::GetTupleElement(output, 0);
+  if (data_type != param_type) {
+    activation_grad = xla::ConvertElementType(
+        activation_grad, DataTypeToPrimitiveType(data_type));
+  }
+  if (ctx->HasOutput("dx_0")) {
+    ctx->SetOutput("dx_0", activation_grad);
+  }
+  if (ctx->HasOutput("gamma_diff_0")) {
+    ctx->SetOutput("gamma_diff_0", xla::GetTupleElement(output, 1));
+  }
+  if (ctx->HasOutput("beta_diff_0")) {
+    ctx->SetOutput("beta_diff_0", xla::GetTupleElement(output, 2));
+  }
+}
+
+REGISTER_XLA_OP_KERNEL(normalization_grad, NormalizationGradOp).Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+
+#include "oneflow_xrt/compiler/xla/ops/op_context.h"
+#include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
+#include "oneflow_xrt/compiler/xla/xla_helpers.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+class OneHotOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape indices_shape = ctx->InputShape("indices_0");
+    Shape out_shape = ctx->OutputShape("out_0");
+    std::vector<long long> out_dims(out_shape.dim_vec().begin(),
+                                    out_shape.dim_vec().end());
+    std::vector<long long> broadcast_dims(indices_shape.NumAxes());
+    std::iota(broadcast_dims.begin(), broadcast_dims.end(), 0);
+
+    xla::XlaBuilder* builder = ctx->builder();
+    xla::PrimitiveType indices_type =
+        DataTypeToPrimitiveType(ctx->InputType("indices_0"));
+    xla::XlaOp iota = xla::Iota(
+        builder, xla::ShapeUtil::MakeShape(indices_type, out_dims),
+        out_shape.NumAxes() - 1);
+    xla::XlaOp is_hot = xla::Eq(
+        iota,
+        xla::BroadcastInDim(ctx->Input("indices_0"), out_dims, broadcast_dims));
+
+    xla::PrimitiveType type = DataTypeToPrimitiveType(ctx->OutputType("out_0"));
+    xla::XlaOp on_value, off_value;
+    if (xla::primitive_util::IsFloatingPointType(type)) {
+      on_value = xla::ConstantR0<double>(
+          builder, ctx->Attr<double>("floating_on_value"));
+      off_value = xla::ConstantR0<double>(
+          builder, ctx->Attr<double>("floating_off_value"));
+    } else {
+      on_value = xla::ConstantR0<long long>(
+          builder, ctx->Attr<int64_t>("integer_on_value"));
+      off_value = xla::ConstantR0<long long>(
+          builder, ctx->Attr<int64_t>("integer_off_value"));
+    }
+    on_value =
+        xla::Broadcast(xla::ConvertElementType(on_value, type), out_dims);
+    off_value =
+        xla::Broadcast(xla::ConvertElementType(off_value, type), out_dims);
+    ctx->SetOutput("out_0", xla::Select(is_hot, on_value, off_value));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(one_hot, OneHotOp).Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
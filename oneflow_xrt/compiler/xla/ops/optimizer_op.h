@@ -36,6 +36,50 @@ class OptimizerOp : public XlaOpKernel {
     ApplyUpdate(ctx, gradient, learning_rate);
   }
 
+ protected:
+  // Reshapes a tensor of shape [1] (e.g. the learning rate) to the rank of
+  // `shape`, so that it can be applied by degenerate dimension broadcasting.
+  xla::XlaOp BroadcastToRank(xla::XlaOp x, const Shape& shape) {
+    if (shape.NumAxes() > 1) {
+      std::vector<long long> bcast_sizes;
+      for (int i = 0; i < shape.NumAxes() - 1; ++i) {
+        bcast_sizes.emplace_back(shape.At(i));
+      }
+      x = xla::Broadcast(x, bcast_sizes);
+    }
+    return x;
+  }
+
+  // Casts the gradient to the model data type, then applies `scale`,
+  // `scale_by_tensor`, and the l1 and l2 regularization.
+  xla::XlaOp RegularizeGradient(XlaOpContext* ctx, xla::XlaOp gradient,
+                                xla::XlaOp weight) {
+    DataType model_dtype = ctx->InputType("model_0");
+    if (model_dtype != ctx->InputType("model_diff_0")) {
+      gradient = xla::ConvertElementType(
+          gradient, DataTypeToPrimitiveType(model_dtype));
+    }
+    if (ctx->HasInput("scale_by_tensor_0")) {
+      gradient = gradient * BroadcastToRank(ctx->Input("scale_by_tensor_0"),
+                                            ctx->InputShape("model_diff_0"));
+    }
+    double scale_val = ctx->Attr<double>("scale");
+    float l1_val = ctx->Attr<float>("l1");
+    float l2_val = ctx->Attr<float>("l2");
+    if (scale_val != 1) {
+      gradient = gradient * xla::ScalarLike(gradient, scale_val);
+    }
+    if (std::abs(l1_val) != 0) {
+      xla::XlaOp l1 = xla::ScalarLike(gradient, l1_val);
+      gradient = gradient + l1 * xla::Sign(weight);
+    }
+    if (std::abs(l2_val) != 0) {
+      xla::XlaOp l2 = xla::ScalarLike(gradient, l2_val);
+      gradient = gradient + l2 * weight;
+    }
+    return gradient;
+  }
+
  private:
   virtual void ApplyUpdate(XlaOpContext* ctx, xla::XlaOp gradient,
                            xla::XlaOp learning_rate) = 0;
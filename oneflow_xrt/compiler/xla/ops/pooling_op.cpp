@@ -0,0 +1,364 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/xla/ops/op_context.h"
+#include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
+#include "oneflow_xrt/compiler/xla/ops/window_util.h"
+#include "oneflow_xrt/compiler/xla/xla_helpers.h"
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/pooling.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+struct PoolingParams {
+  DataLayout layout;
+  std::vector<long long> window;
+  std::vector<long long> strides;
+  std::vector<long long> dilation;
+  std::vector<std::pair<long long, long long>> padding;
+
+  std::vector<std::pair<long long, long long>> SpatialPadding() const {
+    std::vector<std::pair<long long, long long>> spatial_padding;
+    for (int64_t dim : layout.spatial_dims) {
+      spatial_padding.push_back(padding[dim]);
+    }
+    return spatial_padding;
+  }
+
+  xla::TensorFormat tensor_format() const {
+    return xla::TensorFormat(layout.batch_dim, layout.feature_dim,
+                             layout.spatial_dims);
+  }
+};
+
+static PoolingParams GetPoolingParams(XlaOpContext* ctx, const Shape& in_shape,
+                                      const Shape& out_shape,
+                                      bool has_dilation) {
+  int num_axes = in_shape.NumAxes();
+  PoolingParams params;
+  params.layout =
+      MakeDataLayout(ctx->Attr<std::string>("data_format"), num_axes);
+  params.window = MakeWindow(
+      params.layout, ctx->Attr<std::vector<int32_t>>("kernel_size"), num_axes);
+  params.strides = MakeWindow(
+      params.layout, ctx->Attr<std::vector<int32_t>>("stride"), num_axes);
+  params.dilation.assign(num_axes, 1);
+  if (has_dilation) {
+    params.dilation = MakeWindow(
+        params.layout, ctx->Attr<std::vector<int32_t>>("dilation"), num_axes);
+  }
+  params.padding = MakeWindowPadding(
+      params.layout, in_shape, out_shape, params.window, params.strides,
+      params.dilation, ctx->Attr<std::vector<int32_t>>("padding"));
+  return params;
+}
+
+// Returns the flattened spatial index of the first maximum of each window.
+static xla::XlaOp ArgMaxIndices(const xla::XlaOp& input, const Shape& in_shape,
+                                const Shape& out_shape, DataType data_type,
+                                const PoolingParams& params) {
+  const DataLayout& layout = params.layout;
+  int num_spatial_dims = layout.spatial_dims.size();
+  xla::XlaBuilder* builder = input.builder();
+
+  // Transpose to [N, C, spatial...] and view each channel as a sample with a
+  // single feature, i.e. [N * C, 1, spatial...]
+  std::vector<long long> permutation{layout.batch_dim, layout.feature_dim};
+  permutation.insert(permutation.end(), layout.spatial_dims.begin(),
+                     layout.spatial_dims.end());
+  std::vector<long long> in_dims{
+      in_shape.At(layout.batch_dim) * in_shape.At(layout.feature_dim), 1};
+  std::vector<long long> out_dims{in_dims[0]};
+  std::vector<long long> window_dims, strides, dilation;
+  xla::PaddingConfig padding_config;
+  padding_config.add_dimensions();
+  padding_config.add_dimensions();
+  for (int64_t dim : layout.spatial_dims) {
+    in_dims.push_back(in_shape.At(dim));
+    out_dims.push_back(out_shape.At(dim));
+    window_dims.push_back(params.window[dim]);
+    strides.push_back(params.strides[dim]);
+    dilation.push_back(params.dilation[dim]);
+    auto* padding = padding_config.add_dimensions();
+    padding->set_edge_padding_low(params.padding[dim].first);
+    padding->set_edge_padding_high(params.padding[dim].second);
+  }
+  xla::XlaOp x = xla::Reshape(xla::Transpose(input, permutation), in_dims);
+  // Padding with the lowest value never beats the elements of the window
+  xla::PrimitiveType type = DataTypeToPrimitiveType(data_type);
+  x = xla::Pad(x, xla::MinValue(builder, type), padding_config);
+
+  // Extract the K elements of each window into the feature dimension with
+  // strided slices, which copy the values exactly. A one-hot convolution
+  // would lose precision on TF32 and turn 0 * inf into NaN
+  int64_t window_size = 1;
+  for (long long size : window_dims) {
+    window_size *= size;
+  }
+  std::vector<xla::XlaOp> elements;
+  elements.reserve(window_size);
+  for (int64_t k = 0; k < window_size; ++k) {
+    std::vector<long long> window_index(num_spatial_dims);
+    int64_t rest = k;
+    for (int i = num_spatial_dims - 1; i >= 0; --i) {
+      window_index[i] = rest % window_dims[i];
+      rest /= window_dims[i];
+    }
+    std::vector<long long> start_indices{0, 0};
+    std::vector<long long> limit_indices{in_dims[0], 1};
+    std::vector<long long> slice_strides{1, 1};
+    for (int i = 0; i < num_spatial_dims; ++i) {
+      long long begin = window_index[i] * dilation[i];
+      start_indices.push_back(begin);
+      limit_indices.push_back(begin + (out_dims[i + 1] - 1) * strides[i] + 1);
+      slice_strides.push_back(strides[i]);
+    }
+    elements.push_back(
+        xla::Slice(x, start_indices, limit_indices, slice_strides));
+  }
+  // [N * C, K, spatial...]
+  xla::XlaOp patches = xla::ConcatInDim(builder, elements, 1);
+  // [N * C, spatial...]
+  xla::XlaOp offset_in_window = xla::ArgMax(patches, xla::S64, 1);
+
+  // Map the offset in the window back to the flattened input position
+  xla::Shape index_shape = xla::ShapeUtil::MakeShape(xla::S64, out_dims);
+  xla::XlaOp indices = xla::Zeros(builder, index_shape);
+  for (int i = 0; i < num_spatial_dims; ++i) {
+    int64_t dim = layout.spatial_dims[i];
+    int64_t inner_window = 1;
+    for (int j = i + 1; j < num_spatial_dims; ++j) {
+      inner_window *= window_dims[j];
+    }
+    xla::XlaOp k = xla::Rem(
+        xla::Div(offset_in_window, xla::ScalarLike(indices, inner_window)),
+        xla::ScalarLike(indices, window_dims[i]));
+    xla::XlaOp position =
+        xla::Iota(builder, index_shape, i + 1) *
+            xla::ScalarLike(indices, strides[i]) -
+        xla::ScalarLike(indices, params.padding[dim].first) +
+        k * xla::ScalarLike(indices, dilation[i]);
+    indices = indices * xla::ScalarLike(indices, in_shape.At(dim)) + position;
+  }
+
+  // Restore the input layout
+  std::vector<long long> unflatten_dims{in_shape.At(layout.batch_dim),
+                                        in_shape.At(layout.feature_dim)};
+  unflatten_dims.insert(unflatten_dims.end(), out_dims.begin() + 1,
+                        out_dims.end());
+  std::vector<long long> inverse_permutation(permutation.size());
+  for (int i = 0; i < permutation.size(); ++i) {
+    inverse_permutation[permutation[i]] = i;
+  }
+  return xla::Transpose(xla::Reshape(indices, unflatten_dims),
+                        inverse_permutation);
+}
+
+class MaxPoolingOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+};
+
+void MaxPoolingOp::Compile(XlaOpContext* ctx) {
+  Shape in_shape = ctx->InputShape("x_0");
+  Shape out_shape = ctx->OutputShape("y_0");
+  PoolingParams params =
+      GetPoolingParams(ctx, in_shape, out_shape, /*has_dilation=*/true);
+
+  DataType data_type = ctx->InputType("x_0");
+  xla::XlaOp input = ctx->Input("x_0");
+  std::vector<long long> base_dilations(in_shape.NumAxes(), 1);
+  ctx->SetOutput("y_0", xla::ReduceWindowWithGeneralPadding(
+                            input, MinValue(ctx->builder(), data_type),
+                            CreateMaxFunc(data_type), params.window,
+                            params.strides, base_dilations, params.dilation,
+                            params.padding));
+
+  // The indices are only consumed by the native max_pool_2d_grad kernel, so
+  // they are dead and removed by XLA if the gradient is also compiled.
+  if (ctx->HasOutput("indice_0")) {
+    xla::XlaOp indices =
+        ArgMaxIndices(input, in_shape, out_shape, data_type, params);
+    xla::PrimitiveType type =
+        DataTypeToPrimitiveType(ctx->OutputType("indice_0"));
+    ctx->SetOutput("indice_0", xla::ConvertElementType(indices, type));
+  }
+}
+
+REGISTER_XLA_OP_KERNEL(max_pool_2d, MaxPoolingOp).Finalize();
+
+class MaxPoolingGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override;
+
+ private:
+  // SelectAndScatter has no window dilation, so the gradient of the dilated
+  // pooling is scatter-added to the argmax indices of the windows.
+  xla::XlaOp DilatedGrad(XlaOpContext* ctx, const Shape& in_shape,
+                         const Shape& out_shape, DataType data_type,
+                         const PoolingParams& params);
+};
+
+// The gradient is scattered to the first maximum of each window of x, which is
+// the position recorded by the forward indices.
+void MaxPoolingGradOp::Compile(XlaOpContext* ctx) {
+  Shape in_shape = ctx->InputShape("x_0");
+  Shape out_shape = ctx->InputShape("dy_0");
+  PoolingParams params =
+      GetPoolingParams(ctx, in_shape, out_shape, /*has_dilation=*/true);
+
+  DataType data_type = ctx->InputType("dy_0");
+  for (long long dilation : params.dilation) {
+    if (dilation != 1) {
+      ctx->SetOutput("dx_0",
+                     DilatedGrad(ctx, in_shape, out_shape, data_type, params));
+      return;
+    }
+  }
+  ctx->SetOutput(
+      "dx_0", xla::SelectAndScatterWithGeneralPadding(
+                  ctx->Input("x_0"), CreateGeFunc(data_type), params.window,
+                  params.strides, params.padding, ctx->Input("dy_0"),
+                  Zero(ctx->builder(), data_type), CreateAddFunc(data_type)));
+}
+
+xla::XlaOp MaxPoolingGradOp::DilatedGrad(XlaOpContext* ctx,
+                                         const Shape& in_shape,
+                                         const Shape& out_shape,
+                                         DataType data_type,
+                                         const PoolingParams& params) {
+  const DataLayout& layout = params.layout;
+  xla::XlaOp indices = ArgMaxIndices(ctx->Input("x_0"), in_shape, out_shape,
+                                     ctx->InputType("x_0"), params);
+
+  // Flatten dy and the indices to [N * C, out_spatial] in the order of
+  // [N, C, spatial...]
+  std::vector<long long> permutation{layout.batch_dim, layout.feature_dim};
+  permutation.insert(permutation.end(), layout.spatial_dims.begin(),
+                     layout.spatial_dims.end());
+  int64_t num_channels =
+      in_shape.At(layout.batch_dim) * in_shape.At(layout.feature_dim);
+  int64_t in_spatial_size = 1;
+  int64_t out_spatial_size = 1;
+  for (int64_t dim : layout.spatial_dims) {
+    in_spatial_size *= in_shape.At(dim);
+    out_spatial_size *= out_shape.At(dim);
+  }
+  std::vector<long long> flat_dims{num_channels, out_spatial_size};
+  xla::XlaOp dy =
+      xla::Reshape(xla::Transpose(ctx->Input("dy_0"), permutation), flat_dims);
+  indices = xla::Reshape(xla::Transpose(indices, permutation), flat_dims);
+
+  // Offset the spatial indices by the channels to index the flattened dx
+  xla::XlaBuilder* builder = ctx->builder();
+  xla::Shape index_shape = xla::ShapeUtil::MakeShape(xla::S64, flat_dims);
+  indices = indices + xla::Iota(builder, index_shape, 0) *
+                          xla::ScalarLike(indices, in_spatial_size);
+  int64_t num_updates = num_channels * out_spatial_size;
+  indices = xla::Reshape(indices, {num_updates, 1});
+  dy = xla::Reshape(dy, {num_updates});
+
+  xla::ScatterDimensionNumbers dim_numbers;
+  dim_numbers.add_inserted_window_dims(0);
+  dim_numbers.add_scatter_dims_to_operand_dims(0);
+  dim_numbers.set_index_vector_dim(1);
+  xla::XlaOp dx = xla::Broadcast(Zero(builder, data_type),
+                                 {num_channels * in_spatial_size});
+  dx = xla::Scatter(dx, indices, dy, CreateAddFunc(data_type), dim_numbers);
+
+  // Restore the input layout
+  std::vector<long long> unflatten_dims{in_shape.At(layout.batch_dim),
+                                        in_shape.At(layout.feature_dim)};
+  for (int64_t dim : layout.spatial_dims) {
+    unflatten_dims.push_back(in_shape.At(dim));
+  }
+  std::vector<long long> inverse_permutation(permutation.size());
+  for (int i = 0; i < permutation.size(); ++i) {
+    inverse_permutation[permutation[i]] = i;
+  }
+  return xla::Transpose(xla::Reshape(dx, unflatten_dims),
+                        inverse_permutation);
+}
+
+REGISTER_XLA_OP_KERNEL(max_pool_2d_grad, MaxPoolingGradOp).Finalize();
+
+// Average pooling divides the window sums by `divisor_override` if it's set.
+static xla::XlaOp DivisorOverrideScale(XlaOpContext* ctx,
+                                       const PoolingParams& params,
+                                       const xla::XlaOp& x) {
+  int64_t divisor = ctx->Attr<int64_t>("divisor_override");
+  int64_t window_size = 1;
+  for (long long size : params.window) {
+    window_size *= size;
+  }
+  return xla::ScalarLike(x, static_cast<double>(window_size) / divisor);
+}
+
+class AvgPoolingOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape in_shape = ctx->InputShape("x_0");
+    Shape out_shape = ctx->OutputShape("y_0");
+    PoolingParams params =
+        GetPoolingParams(ctx, in_shape, out_shape, /*has_dilation=*/false);
+
+    bool override_divisor = ctx->Attr<int64_t>("divisor_override") != 0;
+    bool count_include_pad =
+        override_divisor || ctx->Attr<bool>("count_include_pad");
+    xla::XlaOp output = xla::AvgPool(
+        ctx->Input("x_0"), params.window, params.strides,
+        params.SpatialPadding(), params.tensor_format(), count_include_pad);
+    if (override_divisor) {
+      output = output * DivisorOverrideScale(ctx, params, output);
+    }
+    ctx->SetOutput("y_0", output);
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(avg_pool_2d, AvgPoolingOp).Finalize();
+
+class AvgPoolingGradOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape in_shape = ctx->InputShape("x_0");
+    Shape out_shape = ctx->InputShape("dy_0");
+    PoolingParams params =
+        GetPoolingParams(ctx, in_shape, out_shape, /*has_dilation=*/false);
+
+    bool override_divisor = ctx->Attr<int64_t>("divisor_override") != 0;
+    bool count_include_pad =
+        override_divisor || ctx->Attr<bool>("count_include_pad");
+    xla::XlaOp dy = ctx->Input("dy_0");
+    if (override_divisor) {
+      dy = dy * DivisorOverrideScale(ctx, params, dy);
+    }
+    std::vector<long long> gradients_size(in_shape.dim_vec().begin(),
+                                          in_shape.dim_vec().end());
+    ctx->SetOutput("dx_0",
+                   xla::AvgPoolGrad(dy, gradients_size, params.window,
+                                    params.strides, params.SpatialPadding(),
+                                    params.tensor_format(), count_include_pad));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(avg_pool_2d_grad, AvgPoolingGradOp).Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
@@ -48,9 +48,15 @@ class ReduceOp : public XlaOpKernel {
 
     xla::XlaBuilder* builder = ctx->builder();
     DataType data_type = ctx->SoleInputType();
-    xla::XlaOp output =
-        xla::Reduce(input, InitValue(builder, data_type), Reduction(data_type),
-                    std::vector<long long>{axis.begin(), axis.end()});
+    // Half precision inputs are reduced in float and cast back afterwards.
+    DataType compute_type = AccumulationType(data_type);
+    input =
+        xla::ConvertElementType(input, DataTypeToPrimitiveType(compute_type));
+    xla::XlaOp output = xla::Reduce(
+        input, InitValue(builder, compute_type), Reduction(compute_type),
+        std::vector<long long>{axis.begin(), axis.end()});
+    output =
+        xla::ConvertElementType(output, DataTypeToPrimitiveType(data_type));
 
     bool keep_dims = ctx->Attr<bool>("keepdims");
     if (keep_dims) {
@@ -0,0 +1,65 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/xla/ops/optimizer_op.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+class RMSPropOptimizerOp : public OptimizerOp {
+ private:
+  void ApplyUpdate(XlaOpContext* ctx, xla::XlaOp gradient,
+                   xla::XlaOp learning_rate) override {
+    xla::XlaOp weight = ctx->Input("model_0");
+    xla::XlaOp mean_square = ctx->Input("mean_square_0");
+    float decay_rate_val = ctx->Attr<float>("decay_rate");
+    float epsilon_val = ctx->Attr<float>("epsilon");
+    float weight_decay_val = ctx->Attr<float>("weight_decay");
+    bool centered = ctx->Attr<bool>("centered");
+    xla::XlaOp lr =
+        BroadcastToRank(learning_rate, ctx->InputShape("model_diff_0"));
+    gradient = RegularizeGradient(ctx, gradient, weight);
+
+    xla::XlaOp one = xla::ScalarLike(mean_square, 1.f);
+    xla::XlaOp decay_rate = xla::ScalarLike(mean_square, decay_rate_val);
+    mean_square =
+        decay_rate * mean_square + (one - decay_rate) * gradient * gradient;
+    ctx->SetOutput("mean_square_0", mean_square);
+
+    xla::XlaOp denominator = mean_square;
+    if (centered) {
+      xla::XlaOp mean_gradient = ctx->Input("mean_gradient_0");
+      mean_gradient =
+          decay_rate * mean_gradient + (one - decay_rate) * gradient;
+      ctx->SetOutput("mean_gradient_0", mean_gradient);
+      denominator = mean_square - mean_gradient * mean_gradient;
+    }
+    xla::XlaOp epsilon = xla::ScalarLike(mean_square, epsilon_val);
+    xla::XlaOp weight_decay = xla::ScalarLike(weight, weight_decay_val);
+    ctx->SetOutput("model_0",
+                   weight - lr * (gradient * xla::Rsqrt(denominator + epsilon) +
+                                  weight_decay * weight));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(rmsprop_update, RMSPropOptimizerOp)
+    .MarkModelUpdateOp()
+    .SetMutableVariables({"model_0", "mean_square_0", "mean_gradient_0"})
+    .Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
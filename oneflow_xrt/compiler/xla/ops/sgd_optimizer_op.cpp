@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/xla/ops/optimizer_op.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+class SgdOptimizerOp : public OptimizerOp {
+ private:
+  void ApplyUpdate(XlaOpContext* ctx, xla::XlaOp gradient,
+                   xla::XlaOp learning_rate) override {
+    xla::XlaOp weight = ctx->Input("model_0");
+    float weight_decay_val = ctx->Attr<float>("weight_decay");
+    xla::XlaOp lr =
+        BroadcastToRank(learning_rate, ctx->InputShape("model_diff_0"));
+    gradient = RegularizeGradient(ctx, gradient, weight);
+
+    xla::XlaOp weight_decay = xla::ScalarLike(weight, weight_decay_val);
+    ctx->SetOutput("model_0", weight - lr * (gradient + weight_decay * weight));
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(sgd_update, SgdOptimizerOp)
+    .MarkModelUpdateOp()
+    .SetMutableVariables({"model_0"})
+    .Finalize();
+
+class MomentumOptimizerOp : public OptimizerOp {
+ private:
+  void ApplyUpdate(XlaOpContext* ctx, xla::XlaOp gradient,
+                   xla::XlaOp learning_rate) override {
+    xla::XlaOp weight = ctx->Input("model_0");
+    xla::XlaOp momentum = ctx->Input("momentum_0");
+    float beta_val = ctx->Attr<float>("beta");
+    float weight_decay_val = ctx->Attr<float>("weight_decay");
+    xla::XlaOp lr =
+        BroadcastToRank(learning_rate, ctx->InputShape("model_diff_0"));
+    gradient = RegularizeGradient(ctx, gradient, weight);
+
+    xla::XlaOp beta = xla::ScalarLike(momentum, beta_val);
+    xla::XlaOp weight_decay = xla::ScalarLike(weight, weight_decay_val);
+    if (ctx->HasAttr("nesterov")) {
+      // momentum = beta * momentum + (1 - dampening) * gradient
+      // weight -= lr * (nesterov ? gradient + beta * momentum : momentum)
+      float dampening_val = ctx->Attr<float>("dampening");
+      xla::XlaOp dampening = xla::ScalarLike(momentum, 1.f - dampening_val);
+      momentum = beta * momentum + dampening * gradient;
+      xla::XlaOp update = momentum;
+      if (ctx->Attr<bool>("nesterov")) {
+        update = gradient + beta * momentum;
+      }
+      if (ctx->HasAttr("maximize") && ctx->Attr<bool>("maximize")) {
+        update = xla::Neg(update);
+      }
+      weight = weight - lr * (update + weight_decay * weight);
+    } else {
+      // momentum = beta * momentum - lr * gradient
+      // weight += momentum - lr * weight_decay * weight
+      momentum = beta * momentum - lr * gradient;
+      weight = weight + momentum - lr * weight_decay * weight;
+    }
+    ctx->SetOutput("momentum_0", momentum);
+    ctx->SetOutput("model_0", weight);
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(momentum_update, MomentumOptimizerOp)
+    .MarkModelUpdateOp()
+    .SetMutableVariables({"model_0", "momentum_0"})
+    .Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
@@ -42,18 +42,23 @@ void SoftmaxOp::Compile(XlaOpContext* ctx) {
   }
 
   DataType data_type = ctx->SoleInputType();
-  xla::XlaOp input = ctx->SoleInput();
-  xla::XlaComputation max_func = CreateMaxFunc(data_type);
+  // Accumulate by float if the input is float16 or bfloat16.
+  DataType compute_type = AccumulationType(data_type);
+  xla::XlaOp input = xla::ConvertElementType(
+      ctx->SoleInput(), DataTypeToPrimitiveType(compute_type));
+  xla::XlaComputation max_func = CreateMaxFunc(compute_type);
   xla::XlaOp logits_max =
-      xla::Reduce(input, MinValue(builder, data_type), max_func, {axis});
+      xla::Reduce(input, MinValue(builder, compute_type), max_func, {axis});
   // y = exp(x - max)
   xla::XlaOp y = xla::Exp(xla::Sub(input, logits_max, batch_dims));
 
-  xla::XlaComputation add_func = CreateAddFunc(data_type);
-  // TODO(hjchen2) Accumulate by float if use bfloat16
-  xla::XlaOp sum = xla::Reduce(y, Zero(builder, data_type), add_func, {axis});
+  xla::XlaComputation add_func = CreateAddFunc(compute_type);
+  xla::XlaOp sum =
+      xla::Reduce(y, Zero(builder, compute_type), add_func, {axis});
   // exp(x - max) / sum(exp(x - max))
-  ctx->SetSoleOutput(xla::Div(y, sum, batch_dims));
+  xla::XlaOp output = xla::Div(y, sum, batch_dims);
+  ctx->SetSoleOutput(
+      xla::ConvertElementType(output, DataTypeToPrimitiveType(data_type)));
 }
 
 REGISTER_XLA_OP_KERNEL(softmax, SoftmaxOp).Finalize();
@@ -79,15 +84,19 @@ void SoftmaxGradOp::Compile(XlaOpContext* ctx) {
     batch_dims[i] = i + 1;
   }
 
-  xla::XlaOp y = ctx->Input("y_0");
-  xla::XlaOp dy = ctx->Input("dy_0");
   DataType data_type = ctx->InputType("y_0");
+  DataType compute_type = AccumulationType(data_type);
+  xla::PrimitiveType type = DataTypeToPrimitiveType(compute_type);
+  xla::XlaOp y = xla::ConvertElementType(ctx->Input("y_0"), type);
+  xla::XlaOp dy = xla::ConvertElementType(ctx->Input("dy_0"), type);
   xla::XlaBuilder* builder = ctx->builder();
 
-  xla::XlaComputation add_func = CreateAddFunc(data_type);
+  xla::XlaComputation add_func = CreateAddFunc(compute_type);
   xla::XlaOp sum =
-      xla::Reduce(y * dy, Zero(builder, data_type), add_func, {axis});
-  ctx->SetOutput("dx_0", y * xla::Sub(dy, sum, batch_dims));
+      xla::Reduce(y * dy, Zero(builder, compute_type), add_func, {axis});
+  xla::XlaOp dx = y * xla::Sub(dy, sum, batch_dims);
+  dx = xla::ConvertElementType(dx, DataTypeToPrimitiveType(data_type));
+  ctx->SetOutput("dx_0", dx);
 }
 
 REGISTER_XLA_OP_KERNEL(softmax_grad, SoftmaxGradOp).Finalize();
@@ -30,12 +30,16 @@ class SquareSumOp : public XlaOpKernel {
     Shape x_shape = ctx->InputShape("x_0");
     xla::XlaBuilder* builder = ctx->builder();
     DataType data_type = ctx->SoleInputType();
+    // Square and accumulate by float if the input is float16 or bfloat16.
+    DataType compute_type = AccumulationType(data_type);
+    x = xla::ConvertElementType(x, DataTypeToPrimitiveType(compute_type));
     xla::XlaOp sum;
     std::vector<long long> x_dims(x_shape.NumAxes());
     std::iota(x_dims.begin(), x_dims.end(), 0);
-    xla::XlaComputation add_func = CreateAddFunc(data_type);
-    sum =
-        xla::Reduce(xla::Square(x), Zero(builder, data_type), add_func, x_dims);
+    xla::XlaComputation add_func = CreateAddFunc(compute_type);
+    sum = xla::Reduce(xla::Square(x), Zero(builder, compute_type), add_func,
+                      x_dims);
+    sum = xla::ConvertElementType(sum, DataTypeToPrimitiveType(data_type));
     ctx->SetSoleOutput(Reshape(sum, Shape({1})));
   }
 };
@@ -37,6 +37,12 @@ struct Gelu {
   }
 };
 
+struct Relu {
+  xla::XlaOp operator()(const xla::XlaOp& x) {
+    return xla::Max(x, xla::ScalarLike(x, 0));
+  }
+};
+
 template <typename UnaryOp>
 class ApplyUnaryOp : public XlaOpKernel {
  public:
@@ -51,6 +57,7 @@ REGISTER_XLA_OP_KERNEL(tanh, ApplyUnaryOp<op::Tanh>).Finalize();
 REGISTER_XLA_OP_KERNEL(gelu, ApplyUnaryOp<Gelu>).Finalize();
 REGISTER_XLA_OP_KERNEL(rsqrt, ApplyUnaryOp<op::Rsqrt>).Finalize();
 REGISTER_XLA_OP_KERNEL(sqrt, ApplyUnaryOp<op::Sqrt>).Finalize();
+REGISTER_XLA_OP_KERNEL(relu, ApplyUnaryOp<Relu>).Finalize();
 
 struct Identity {
   xla::XlaOp operator()(const xla::XlaOp& x) { return x; }
@@ -0,0 +1,60 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+
+#include "oneflow_xrt/compiler/xla/ops/op_context.h"
+#include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
+#include "oneflow_xrt/compiler/xla/xla_helpers.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+class WhereOp : public XlaOpKernel {
+ public:
+  void Compile(XlaOpContext* ctx) override {
+    Shape out_shape = ctx->OutputShape("out_0");
+    xla::XlaOp condition = BroadcastTo(ctx, "condition_0", out_shape);
+    condition = xla::Ne(condition, xla::ZerosLike(condition));
+    ctx->SetOutput("out_0", xla::Select(condition,
+                                        BroadcastTo(ctx, "x_0", out_shape),
+                                        BroadcastTo(ctx, "y_0", out_shape)));
+  }
+
+ private:
+  // Numpy style broadcasting of input `name` to `shape`
+  xla::XlaOp BroadcastTo(XlaOpContext* ctx, const std::string& name,
+                         const Shape& shape) {
+    Shape in_shape = ctx->InputShape(name);
+    xla::XlaOp input = ctx->Input(name);
+    if (in_shape == shape) {
+      return input;
+    }
+    std::vector<long long> dims(shape.dim_vec().begin(), shape.dim_vec().end());
+    std::vector<long long> broadcast_dims(in_shape.NumAxes());
+    std::iota(broadcast_dims.begin(), broadcast_dims.end(),
+              shape.NumAxes() - in_shape.NumAxes());
+    return xla::BroadcastInDim(input, dims, broadcast_dims);
+  }
+};
+
+REGISTER_XLA_OP_KERNEL(where, WhereOp).Finalize();
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
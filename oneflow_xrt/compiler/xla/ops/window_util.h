@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMPILER_XLA_OPS_WINDOW_UTIL_H_
+#define ONEFLOW_XRT_COMPILER_XLA_OPS_WINDOW_UTIL_H_
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "oneflow/core/common/shape.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+// Positions of the batch, feature and spatial dimensions of a tensor laid out
+// as `data_format`. Filters share the same convention with the output channel
+// as batch dimension and the input channel as feature dimension.
+struct DataLayout {
+  int64_t batch_dim = 0;
+  int64_t feature_dim = 1;
+  std::vector<long long> spatial_dims;
+};
+
+inline DataLayout MakeDataLayout(const std::string& data_format,
+                                 int num_axes) {
+  CHECK_GE(num_axes, 3);
+  DataLayout layout;
+  if (data_format == "channels_first") {
+    layout.feature_dim = 1;
+    for (int i = 2; i < num_axes; ++i) {
+      layout.spatial_dims.push_back(i);
+    }
+  } else {
+    CHECK_EQ(data_format, "channels_last")
+        << "Unsupported data format " << data_format;
+    layout.feature_dim = num_axes - 1;
+    for (int i = 1; i < num_axes - 1; ++i) {
+      layout.spatial_dims.push_back(i);
+    }
+  }
+  return layout;
+}
+
+// Returns the window size or stride of all dimensions, which is 1 on the batch
+// and feature dimensions.
+inline std::vector<long long> MakeWindow(const DataLayout& layout,
+                                         const std::vector<int32_t>& values,
+                                         int num_axes) {
+  CHECK_EQ(values.size(), layout.spatial_dims.size());
+  std::vector<long long> window(num_axes, 1);
+  for (int i = 0; i < values.size(); ++i) {
+    window[layout.spatial_dims[i]] = values[i];
+  }
+  return window;
+}
+
+// Returns the (low, high) padding of all dimensions. The high padding is
+// inferred from the output size, so ceil mode windows are covered as well.
+inline std::vector<std::pair<long long, long long>> MakeWindowPadding(
+    const DataLayout& layout, const Shape& in_shape, const Shape& out_shape,
+    const std::vector<long long>& window, const std::vector<long long>& strides,
+    const std::vector<long long>& dilation,
+    const std::vector<int32_t>& padding_before) {
+  std::vector<std::pair<long long, long long>> padding(in_shape.NumAxes(),
+                                                       {0, 0});
+  for (int i = 0; i < layout.spatial_dims.size(); ++i) {
+    int64_t dim = layout.spatial_dims[i];
+    int64_t effective_window = (window[dim] - 1) * dilation[dim] + 1;
+    int64_t padding_after = (out_shape.At(dim) - 1) * strides[dim] +
+                            effective_window - in_shape.At(dim) -
+                            padding_before[i];
+    padding[dim] = {padding_before[i], std::max<int64_t>(padding_after, 0)};
+  }
+  return padding;
+}
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMPILER_XLA_OPS_WINDOW_UTIL_H_
@@ -0,0 +1,332 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/xla/xla_attention_fusion.h"
+
+#include "oneflow_xrt/common/env.h"
+#include "oneflow_xrt/compiler/xla/xla_data_type.h"
+#include "oneflow_xrt/compiler/xla/xla_helpers.h"
+#include "oneflow_xrt/compiler/xla/xla_macro.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+namespace {
+
+// Returns the only node consuming the outputs of `node`, or nullptr if the
+// outputs are consumed by more than one node.
+const XrtNode* SoleConsumer(const XrtNode* node) {
+  const XrtNode* consumer = nullptr;
+  for (const XrtEdge* edge : node->out_edges()) {
+    if (edge->IsControlEdge()) {
+      continue;
+    }
+    if (consumer && consumer != edge->end()) {
+      return nullptr;
+    }
+    consumer = edge->end();
+  }
+  return consumer;
+}
+
+const XrtEdge* InputEdge(const XrtNode* node, const std::string& key) {
+  for (const XrtEdge* edge : node->in_edges()) {
+    if (!edge->IsControlEdge() &&
+        edge->argument().meta_data().consume_key == key) {
+      return edge;
+    }
+  }
+  return nullptr;
+}
+
+template <typename T>
+T NodeAttr(const XrtNode* node, const std::string& name) {
+  return CHECK_JUST(node->attrs().GetAttr<T>(name));
+}
+
+bool IsFusibleMatMul(const XrtNode* node) {
+  return node->type() == "batch_matmul" &&
+         !InputEdge(node, "_add_to_output_0");
+}
+
+bool IsSupportedDataType(DataType data_type) {
+  return data_type == DataType::kFloat || data_type == DataType::kDouble ||
+         data_type == DataType::kFloat16 || data_type == DataType::kBFloat16;
+}
+
+bool MatchScale(const XrtNode* node, double* scale) {
+  if (node->type() != "scalar_mul") {
+    return false;
+  }
+  if (NodeAttr<bool>(node, "has_float_operand")) {
+    *scale = NodeAttr<double>(node, "float_operand");
+  } else if (NodeAttr<bool>(node, "has_int_operand")) {
+    *scale = NodeAttr<int64_t>(node, "int_operand");
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool MatchAttention(const XrtNode* node, int64_t block_size,
+                    AttentionPattern* pattern) {
+  if (!IsFusibleMatMul(node)) {
+    return false;
+  }
+  pattern->qk_matmul = node;
+  const XrtNode* next = SoleConsumer(node);
+  if (next && MatchScale(next, &pattern->scale_value)) {
+    pattern->scale = next;
+    next = SoleConsumer(next);
+  }
+  if (!next || next->type() != "softmax") {
+    return false;
+  }
+  pattern->softmax = next;
+  next = SoleConsumer(next);
+  if (!next || !IsFusibleMatMul(next) || NodeAttr<bool>(next, "transpose_a")) {
+    return false;
+  }
+  const XrtEdge* p_edge = InputEdge(next, "a_0");
+  if (!p_edge || p_edge->start() != pattern->softmax) {
+    return false;
+  }
+  pattern->pv_matmul = next;
+
+  const XrtEdge* q_edge = InputEdge(pattern->qk_matmul, "a_0");
+  const XrtEdge* k_edge = InputEdge(pattern->qk_matmul, "b_0");
+  const XrtEdge* v_edge = InputEdge(pattern->pv_matmul, "b_0");
+  if (!q_edge || !k_edge || !v_edge) {
+    return false;
+  }
+  pattern->q = q_edge->argument();
+  pattern->k = k_edge->argument();
+  pattern->v = v_edge->argument();
+  pattern->transpose_q = NodeAttr<bool>(pattern->qk_matmul, "transpose_a");
+  pattern->transpose_k = !NodeAttr<bool>(pattern->qk_matmul, "transpose_b");
+  pattern->transpose_v = NodeAttr<bool>(pattern->pv_matmul, "transpose_b");
+
+  DataType data_type = pattern->q.data_type();
+  if (!IsSupportedDataType(data_type) ||
+      pattern->k.data_type() != data_type ||
+      pattern->v.data_type() != data_type) {
+    return false;
+  }
+  const Shape& k_shape = pattern->k.shape();
+  int64_t k_axis = k_shape.NumAxes() - (pattern->transpose_k ? 1 : 2);
+  int64_t k_len = k_shape.At(k_axis);
+  // Short sequences are lowered as usual since there is nothing to tile.
+  return k_len > block_size;
+}
+
+// Swap the last two dimensions if `transpose` is true, then collapse all the
+// batch dimensions into one.
+xla::XlaOp CanonicalizeOperand(xla::XlaOp x, const Shape& shape,
+                               bool transpose) {
+  int64_t num_axes = shape.NumAxes();
+  int64_t rows = shape.At(num_axes - 2);
+  int64_t cols = shape.At(num_axes - 1);
+  if (transpose) {
+    std::vector<long long> permutation(num_axes);
+    for (int i = 0; i < num_axes; ++i) {
+      permutation[i] = i;
+    }
+    std::swap(permutation[num_axes - 2], permutation[num_axes - 1]);
+    x = xla::Transpose(x, permutation);
+    std::swap(rows, cols);
+  }
+  int64_t batch = shape.Count(0, num_axes - 2);
+  return xla::Reshape(x, {batch, rows, cols});
+}
+
+xla::XlaOp PadRows(xla::XlaOp x, xla::XlaOp pad_value, int64_t padding) {
+  if (padding == 0) {
+    return x;
+  }
+  xla::PaddingConfig padding_config;
+  padding_config.add_dimensions();
+  padding_config.add_dimensions()->set_edge_padding_high(padding);
+  padding_config.add_dimensions();
+  return xla::Pad(x, pad_value, padding_config);
+}
+
+}  // namespace
+
+int64_t AttentionBlockSize() {
+  return EnvToInt64(ONEFLOW_XRT_XLA_ATTENTION_BLOCK_SIZE, 512);
+}
+
+std::vector<AttentionPattern> MatchAttentionPatterns(const XrtGraph* graph,
+                                                     int64_t block_size) {
+  std::vector<AttentionPattern> patterns;
+  if (block_size <= 0) {
+    return patterns;
+  }
+  for (const XrtNode* node : graph->Nodes()) {
+    AttentionPattern pattern;
+    if (MatchAttention(node, block_size, &pattern)) {
+      patterns.push_back(pattern);
+    }
+  }
+  return patterns;
+}
+
+// For each key block j, with running max m, running sum l and unnormalized
+// output acc:
+//   s = q * k_j^T, m' = max(m, rowmax(s)), p = exp(s - m')
+//   l = l * exp(m - m') + rowsum(p), acc = acc * exp(m - m') + p * v_j
+// and the result is acc / l after the last block.
+xla::XlaOp BuildBlockedAttention(const AttentionPattern& pattern,
+                                 xla::XlaOp q, xla::XlaOp k, xla::XlaOp v,
+                                 int64_t block_size) {
+  xla::XlaBuilder* builder = q.builder();
+  DataType data_type = pattern.q.data_type();
+  // Accumulate by float for half inputs.
+  DataType compute_type = AccumulationType(data_type);
+  xla::PrimitiveType type = DataTypeToPrimitiveType(compute_type);
+
+  const Shape& in_shape = pattern.q.shape();
+  q = CanonicalizeOperand(q, in_shape, pattern.transpose_q);
+  k = CanonicalizeOperand(k, pattern.k.shape(), pattern.transpose_k);
+  v = CanonicalizeOperand(v, pattern.v.shape(), pattern.transpose_v);
+  q = xla::ConvertElementType(q, type);
+  k = xla::ConvertElementType(k, type);
+  v = xla::ConvertElementType(v, type);
+
+  MOLA_CHECK_AND_ASSIGN(xla::Shape q_shape, builder->GetShape(q));
+  MOLA_CHECK_AND_ASSIGN(xla::Shape v_shape_3d, builder->GetShape(v));
+  const int64_t batch = q_shape.dimensions(0);
+  const int64_t q_len = q_shape.dimensions(1);
+  const int64_t head_size = q_shape.dimensions(2);
+  const int64_t k_len = v_shape_3d.dimensions(1);
+  const int64_t v_head_size = v_shape_3d.dimensions(2);
+  const int64_t num_blocks = (k_len + block_size - 1) / block_size;
+  const int64_t padding = num_blocks * block_size - k_len;
+
+  // Scale q once instead of scaling every score tile.
+  if (pattern.scale_value != 1.0) {
+    q = xla::Mul(q, FloatLiteral(builder, compute_type, pattern.scale_value));
+  }
+  k = PadRows(k, Zero(builder, compute_type), padding);
+  v = PadRows(v, Zero(builder, compute_type), padding);
+
+  xla::Shape row_shape = xla::ShapeUtil::MakeShape(type, {batch, q_len});
+  xla::Shape acc_shape =
+      xla::ShapeUtil::MakeShape(type, {batch, q_len, v_head_size});
+  MOLA_CHECK_AND_ASSIGN(xla::Shape k_shape, builder->GetShape(k));
+  MOLA_CHECK_AND_ASSIGN(xla::Shape v_padded_shape, builder->GetShape(v));
+  xla::Shape state_shape = xla::ShapeUtil::MakeTupleShape(
+      {xla::ShapeUtil::MakeShape(xla::S32, {}), row_shape, row_shape,
+       acc_shape, q_shape, k_shape, v_padded_shape});
+
+  // Loop condition: block index < num_blocks.
+  xla::XlaComputation condition;
+  {
+    auto cond_builder = builder->CreateSubBuilder("attention_cond");
+    xla::XlaOp state =
+        xla::Parameter(cond_builder.get(), 0, state_shape, "state");
+    xla::Lt(xla::GetTupleElement(state, 0),
+            xla::ConstantR0<int32_t>(cond_builder.get(), num_blocks));
+    MOLA_CHECK_AND_ASSIGN(condition, cond_builder->Build());
+  }
+
+  // Loop body: fold one key/value block into the running statistics.
+  xla::XlaComputation body;
+  {
+    auto body_builder = builder->CreateSubBuilder("attention_body");
+    xla::XlaBuilder* b = body_builder.get();
+    xla::XlaOp state = xla::Parameter(b, 0, state_shape, "state");
+    xla::XlaOp index = xla::GetTupleElement(state, 0);
+    xla::XlaOp m = xla::GetTupleElement(state, 1);
+    xla::XlaOp l = xla::GetTupleElement(state, 2);
+    xla::XlaOp acc = xla::GetTupleElement(state, 3);
+    xla::XlaOp q_in = xla::GetTupleElement(state, 4);
+    xla::XlaOp k_in = xla::GetTupleElement(state, 5);
+    xla::XlaOp v_in = xla::GetTupleElement(state, 6);
+
+    xla::XlaOp zero = xla::ConstantR0<int32_t>(b, 0);
+    xla::XlaOp start =
+        xla::Mul(index, xla::ConstantR0<int32_t>(b, block_size));
+    xla::XlaOp k_block = xla::DynamicSlice(k_in, {zero, start, zero},
+                                           {batch, block_size, head_size});
+    xla::XlaOp v_block = xla::DynamicSlice(v_in, {zero, start, zero},
+                                           {batch, block_size, v_head_size});
+
+    xla::DotDimensionNumbers qk_dims;
+    qk_dims.add_lhs_batch_dimensions(0);
+    qk_dims.add_rhs_batch_dimensions(0);
+    qk_dims.add_lhs_contracting_dimensions(2);
+    qk_dims.add_rhs_contracting_dimensions(2);
+    // [batch, q_len, block_size]
+    xla::XlaOp scores = xla::DotGeneral(q_in, k_block, qk_dims);
+    if (padding > 0) {
+      xla::Shape position_shape =
+          xla::ShapeUtil::MakeShape(xla::S32, {batch, q_len, block_size});
+      xla::XlaOp position = xla::Add(xla::Iota(b, position_shape, 2), start);
+      xla::XlaOp valid =
+          xla::Lt(position, xla::ConstantR0<int32_t>(b, k_len));
+      xla::XlaOp lowest =
+          xla::Broadcast(MinValue(b, compute_type), {batch, q_len, block_size});
+      scores = xla::Select(valid, scores, lowest);
+    }
+
+    xla::XlaOp block_max = xla::Reduce(scores, MinValue(b, compute_type),
+                                       CreateMaxFunc(compute_type), {2});
+    xla::XlaOp new_m = xla::Max(m, block_max);
+    xla::XlaOp correction = xla::Exp(xla::Sub(m, new_m));
+    xla::XlaOp p = xla::Exp(xla::Sub(scores, new_m, {0, 1}));
+    xla::XlaOp block_sum = xla::Reduce(p, Zero(b, compute_type),
+                                       CreateAddFunc(compute_type), {2});
+    xla::XlaOp new_l = xla::Add(xla::Mul(l, correction), block_sum);
+
+    xla::DotDimensionNumbers pv_dims;
+    pv_dims.add_lhs_batch_dimensions(0);
+    pv_dims.add_rhs_batch_dimensions(0);
+    pv_dims.add_lhs_contracting_dimensions(2);
+    pv_dims.add_rhs_contracting_dimensions(1);
+    xla::XlaOp new_acc = xla::Add(xla::Mul(acc, correction, {0, 1}),
+                                  xla::DotGeneral(p, v_block, pv_dims));
+
+    xla::Tuple(b, {xla::Add(index, xla::ConstantR0<int32_t>(b, 1)), new_m,
+                   new_l, new_acc, q_in, k_in, v_in});
+    MOLA_CHECK_AND_ASSIGN(body, body_builder->Build());
+  }
+
+  xla::XlaOp init = xla::Tuple(
+      builder,
+      {xla::ConstantR0<int32_t>(builder, 0),
+       xla::Broadcast(MinValue(builder, compute_type), {batch, q_len}),
+       xla::Broadcast(Zero(builder, compute_type), {batch, q_len}),
+       xla::Broadcast(Zero(builder, compute_type),
+                      {batch, q_len, v_head_size}),
+       q, k, v});
+  xla::XlaOp result = xla::While(condition, body, init);
+  xla::XlaOp out = xla::Div(xla::GetTupleElement(result, 3),
+                            xla::GetTupleElement(result, 2), {0, 1});
+  out = xla::ConvertElementType(out, DataTypeToPrimitiveType(data_type));
+
+  // Restore the batch dimensions of the outputs of `pv_matmul`.
+  DimVector out_dims(in_shape.dim_vec().begin(),
+                     in_shape.dim_vec().end() - 2);
+  out_dims.push_back(q_len);
+  out_dims.push_back(v_head_size);
+  return Reshape(out, Shape(out_dims));
+}
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMPILER_XLA_XLA_ATTENTION_FUSION_H_
+#define ONEFLOW_XRT_COMPILER_XLA_XLA_ATTENTION_FUSION_H_
+
+#include <vector>
+
+#include "oneflow_xrt/graph/argument.h"
+#include "oneflow_xrt/graph/graph.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+// Scaled dot-product attention found in a graph, which is a chain like
+//   s = batch_matmul(q, k) -> [scalar_mul(s, scale)] -> p = softmax(s)
+//     -> out = batch_matmul(p, v)
+// All the intermediate results are consumed only by the next node of the
+// chain, so the chain can be lowered as a whole without materializing the
+// full score matrix.
+struct AttentionPattern {
+  const XrtNode* qk_matmul = nullptr;
+  const XrtNode* scale = nullptr;
+  const XrtNode* softmax = nullptr;
+  const XrtNode* pv_matmul = nullptr;
+
+  Argument q;
+  Argument k;
+  Argument v;
+  bool transpose_q = false;
+  bool transpose_k = false;
+  bool transpose_v = false;
+  double scale_value = 1.0;
+};
+
+// Returns the block size used to tile the key sequence. The attention chains
+// whose key sequence is not longer than one block are not fused. It can be
+// set by env ONEFLOW_XRT_XLA_ATTENTION_BLOCK_SIZE, and a non-positive value
+// disables the fusion.
+int64_t AttentionBlockSize();
+
+std::vector<AttentionPattern> MatchAttentionPatterns(const XrtGraph* graph,
+                                                     int64_t block_size);
+
+// Build the attention with an online softmax that loops over the key and
+// value blocks, so that only a [batch, q_len, block_size] score tile is alive
+// at any time. The result has the same shape as the output of `pv_matmul`.
+xla::XlaOp BuildBlockedAttention(const AttentionPattern& pattern,
+                                 xla::XlaOp q, xla::XlaOp k, xla::XlaOp v,
+                                 int64_t block_size);
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMPILER_XLA_XLA_ATTENTION_FUSION_H_
@@ -40,6 +40,10 @@ xla::PrimitiveType DataTypeToPrimitiveType(DataType data_type) {
       return xla::U8;
     case oneflow::kFloat16:
       return xla::F16;
+    case oneflow::kBFloat16:
+      return xla::BF16;
+    case oneflow::kBool:
+      return xla::PRED;
     default: {
       LOG(FATAL) << "Unsupported data type (" << data_type
                  << ") in DataTypeToPrimitiveType";
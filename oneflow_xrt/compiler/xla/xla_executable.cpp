@@ -26,6 +26,7 @@ namespace mola {
 
 bool XlaExecutable::Run(const std::vector<Parameter>& inputs,
                         const ExecutableRunOptions& run_options,
+                        std::vector<Parameter>* results,
                         bool block_until_done) {
   CHECK_EQ(inputs.size(), input_shapes_.size())
       << "Size mismatch between input params and input shapes.";
@@ -68,7 +69,7 @@ bool XlaExecutable::Run(const std::vector<Parameter>& inputs,
     }
   }
 
-  this->results_ = std::move(return_params);
+  *results = return_params;
   return true /*Success*/;
 }
 
@@ -39,6 +39,7 @@ class XlaExecutable : public Executable {
 
   bool Run(const std::vector<Parameter>& inputs,
            const ExecutableRunOptions& run_options,
+           std::vector<Parameter>* results,
            bool block_until_done = true) override;
 
  private:
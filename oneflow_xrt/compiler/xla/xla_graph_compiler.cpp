@@ -15,12 +15,26 @@ limitations under the License.
 */
 #include "oneflow_xrt/compiler/xla/xla_graph_compiler.h"
 
+#include <fstream>
+#include <unordered_set>
+
 #include "oneflow_xrt/compiler/xla/ops/op_context.h"
 #include "oneflow_xrt/compiler/xla/ops/op_kernel.h"
+#include "oneflow_xrt/compiler/xla/xla_data_type.h"
 #include "oneflow_xrt/compiler/xla/xla_resource_manager.h"
 #include "oneflow_xrt/compiler/xla/xla_shape.h"
 #include "oneflow_xrt/graph/node_util.h"
+#include "tensorflow/compiler/xla/debug_options_flags.h"
+#include "tensorflow/compiler/xla/service/buffer_value.h"
+#include "tensorflow/compiler/xla/service/heap_simulator.h"
+#include "tensorflow/compiler/xla/service/hlo_cse.h"
+#include "tensorflow/compiler/xla/service/hlo_memory_scheduler.h"
+#include "tensorflow/compiler/xla/service/hlo_module.h"
+#include "tensorflow/compiler/xla/service/hlo_module_config.h"
+#include "tensorflow/compiler/xla/service/hlo_pass_pipeline.h"
+#include "tensorflow/compiler/xla/service/hlo_rematerialization.h"
 #include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/core/platform/protobuf.h"
 
 namespace oneflow {
 namespace xrt {
@@ -90,18 +104,127 @@ void XlaGraphCompiler::SetupKernelContextParam(
   context_param->num_outputs = num_outputs;
 }
 
+void XlaGraphCompiler::LowerKernelPrecision(
+    XlaOpContext::Param* context_param,
+    std::unordered_map<Argument, Argument>* float_outputs) {
+  xla::PrimitiveType type = DataTypeToPrimitiveType(mixed_precision_type_);
+  std::unordered_map<Argument, XlaValue> inputs;
+  for (const auto& it : context_param->inputs) {
+    const Argument& arg = it.first;
+    if (arg.data_type() != DataType::kFloat) {
+      inputs.emplace(arg, it.second);
+      continue;
+    }
+    Argument low_arg = arg;
+    low_arg.set_data_type(mixed_precision_type_);
+    auto low_operand = low_precision_operands_.find(arg);
+    if (low_operand == low_precision_operands_.end()) {
+      xla::XlaOp handle = xla::ConvertElementType(
+          it.second.AsXlaOp(builder_.get()), type);
+      low_operand =
+          low_precision_operands_.emplace(arg, XlaValue::XlaOp(handle)).first;
+    }
+    inputs.emplace(low_arg, low_operand->second);
+  }
+  for (auto& it : context_param->arguments) {
+    Argument& arg = it.second;
+    if (arg.data_type() != DataType::kFloat) {
+      continue;
+    }
+    bool is_input = context_param->inputs.count(arg) > 0;
+    Argument float_arg = arg;
+    arg.set_data_type(mixed_precision_type_);
+    if (!is_input) {
+      float_outputs->emplace(arg, float_arg);
+    }
+  }
+  context_param->inputs = std::move(inputs);
+}
+
+void XlaGraphCompiler::SetKernelOutputs(
+    const std::unordered_map<Argument, XlaValue>& outputs,
+    const std::unordered_map<Argument, Argument>& float_outputs) {
+  for (auto it = outputs.begin(); it != outputs.end(); ++it) {
+    const auto& float_output = float_outputs.find(it->first);
+    if (float_output == float_outputs.end()) {
+      operands_[it->first] = it->second;
+      continue;
+    }
+    // Keep the low precision output for the following low precision kernels,
+    // and cast it back to float for the others.
+    const Argument& arg = float_output->second;
+    low_precision_operands_[arg] = it->second;
+    xla::XlaOp handle =
+        xla::ConvertElementType(it->second.AsXlaOp(builder_.get()), xla::F32);
+    operands_[arg] = XlaValue::XlaOp(handle);
+  }
+}
+
+void XlaGraphCompiler::BuildAttention(const AttentionPattern& pattern,
+                                      int64_t block_size) {
+  const XrtNode* node = pattern.pv_matmul;
+  SetOpMetadata("scaled_dot_product_attention", node->name());
+  xla::XlaOp out = BuildBlockedAttention(
+      pattern, operands_.at(pattern.q).AsXlaOp(builder_.get()),
+      operands_.at(pattern.k).AsXlaOp(builder_.get()),
+      operands_.at(pattern.v).AsXlaOp(builder_.get()), block_size);
+  ClearOpMetadata();
+  for (const XrtEdge* edge : node->out_edges()) {
+    if (!edge->IsControlEdge()) {
+      operands_[edge->argument()] = XlaValue::XlaOp(out);
+    }
+  }
+}
+
 void XlaGraphCompiler::BuildComputation(
     const XrtGraph* graph, const std::vector<Argument>& return_args,
     xla::Shape* output_shape, xla::XlaComputation* computation) {
+  // Rewrite the scaled dot-product attention chains before lowering. The
+  // nodes inside a chain are skipped, and the whole chain is lowered when
+  // visiting its last batch_matmul.
+  int64_t block_size = AttentionBlockSize();
+  std::unordered_map<const XrtNode*, AttentionPattern> attentions;
+  std::unordered_set<const XrtNode*> fused_nodes;
+  for (const auto& pattern : MatchAttentionPatterns(graph, block_size)) {
+    std::vector<const XrtNode*> nodes{pattern.qk_matmul, pattern.softmax,
+                                      pattern.pv_matmul};
+    if (pattern.scale) {
+      nodes.push_back(pattern.scale);
+    }
+    bool overlapped = false;
+    for (const XrtNode* node : nodes) {
+      overlapped |= fused_nodes.count(node) > 0;
+    }
+    if (overlapped) {
+      continue;
+    }
+    fused_nodes.insert(nodes.begin(), nodes.end());
+    attentions.emplace(pattern.pv_matmul, pattern);
+  }
+
   // Compile each node as topology order.
   algorithm::TopologyVisit(*graph, [&](const XrtNode* node) {
     if (node->IsNoOpNode()) {
       return;
     }
+    const auto& attention = attentions.find(node);
+    if (attention != attentions.end()) {
+      BuildAttention(attention->second, block_size);
+      return;
+    }
+    if (fused_nodes.count(node)) {
+      return;
+    }
     SetOpMetadata(node->type(), node->name());
     // Setup param to build an XlaOpContext.
     XlaOpContext::Param param;
     SetupKernelContextParam(node, &param);
+    std::unordered_map<Argument, Argument> float_outputs;
+    if (mixed_precision_type_ != DataType::kInvalidDataType &&
+        IsLowPrecisionOp(node->type(),
+                         options_.xla_aggressive_mixed_precision())) {
+      LowerKernelPrecision(&param, &float_outputs);
+    }
     XlaOpContext op_context(param);
     // Do compile, lower the operator computation to HLO instructions.
     auto op_kernel = BuildOpKernel(this->device_, node->type());
@@ -109,10 +232,7 @@ void XlaGraphCompiler::BuildComputation(
 
     ClearOpMetadata();
     // Always insert the new output into `operands_`.
-    const auto& outputs = op_context.outputs();
-    for (auto it = outputs.begin(); it != outputs.end(); ++it) {
-      operands_[it->first] = it->second;
-    }
+    SetKernelOutputs(op_context.outputs(), float_outputs);
   });
 
   // Always insert a final tuple XlaOp to ensure the computation ends with
@@ -142,6 +262,117 @@ void XlaGraphCompiler::BuildComputation(
   }
 }
 
+void XlaGraphCompiler::SetupDebugOptions(
+    xla::ExecutableBuildOptions* build_options, bool rematerialized) {
+  const std::string& debug_options_text = options_.xla_debug_options();
+  if (debug_options_text.empty() && !rematerialized) {
+    return;
+  }
+  // Start from the defaults so that XLA_FLAGS still take effect.
+  xla::DebugOptions* debug_options = build_options->mutable_debug_options();
+  *debug_options = xla::GetDebugOptionsFromFlags();
+  CHECK(tensorflow::protobuf::TextFormat::MergeFromString(debug_options_text,
+                                                          debug_options))
+      << "invalid xla debug options: " << debug_options_text;
+  if (rematerialized) {
+    // CSE would merge the recomputed instructions back into the originals,
+    // and XLA can not exclude some instructions from it. The computation has
+    // been deduplicated by CSE before rematerialization, so disabling it
+    // only keeps the recomputed instructions and the duplicates created by
+    // the later backend passes.
+    debug_options->add_xla_disable_hlo_passes("cse");
+  }
+}
+
+int64_t XlaGraphCompiler::RematerializationMemoryLimit() const {
+  if (!options_.xla_rematerialization()) {
+    return 0;
+  }
+  if (options_.max_workspace_size() <= 0) {
+    LOG(WARNING) << "xla rematerialization is skipped for " << builder_->name()
+                 << " since max_workspace_size is not set";
+    return 0;
+  }
+  return options_.max_workspace_size();
+}
+
+xla::XlaComputation XlaGraphCompiler::Rematerialize(
+    const xla::XlaComputation& computation, int64_t memory_limit) {
+  MOLA_CHECK_AND_ASSIGN(auto program_shape, computation.GetProgramShape());
+  xla::HloModuleConfig config(program_shape);
+  MOLA_CHECK_AND_ASSIGN(auto module, xla::HloModule::CreateFromProto(
+                                         computation.proto(), config));
+
+  auto shape_size = [](const xla::Shape& shape) {
+    return xla::ShapeUtil::ByteSizeOf(shape, sizeof(void*));
+  };
+  auto buffer_size = [&](const xla::BufferValue& buffer) {
+    return shape_size(buffer.shape());
+  };
+  // Rematerialization runs on the scheduled module, and recomputes the
+  // instructions whose results are live across the peak memory point. The
+  // duplicates are merged by CSE first, since the backend CSE is disabled.
+  xla::HloRematerialization::RematerializationSizes sizes;
+  xla::HloPassPipeline pipeline("rematerialization");
+  pipeline.AddPass<xla::HloCSE>(/*is_layout_sensitive=*/false);
+  pipeline.AddPass<xla::HloMemoryScheduler>(buffer_size);
+  pipeline.AddPass<xla::HloRematerialization>(
+      shape_size, memory_limit, &sizes,
+      xla::HloRematerialization::RematerializationPass::kPreFusion,
+      /*block_size_limit=*/1, /*compact_shape_function=*/nullptr,
+      xla::HloRematerialization::RematerializationMode::kRecomputeOnly);
+  MOLA_CHECK_AND_ASSIGN(bool changed, pipeline.Run(module.get()));
+  VLOG(2) << "rematerialization of " << builder_->name() << " with limit "
+          << memory_limit << " bytes, changed: " << changed
+          << ", peak memory: " << sizes.before_bytes << " -> "
+          << sizes.after_bytes << " bytes";
+  return xla::XlaComputation(module->ToProto());
+}
+
+void XlaGraphCompiler::CheckPeakMemory(const xla::LocalExecutable& executable,
+                                       int64_t memory_limit) {
+  // The backend reschedules and fuses the rematerialized module, so the peak
+  // memory is measured again on the schedule of the optimized module.
+  const xla::HloModule& module = executable.executable()->module();
+  if (!module.has_schedule()) {
+    VLOG(2) << "the peak memory of " << builder_->name()
+            << " is unknown since the optimized module has no schedule";
+    return;
+  }
+  auto buffer_size = [](const xla::BufferValue& buffer) {
+    return xla::ShapeUtil::ByteSizeOf(buffer.shape(), sizeof(void*));
+  };
+  MOLA_CHECK_AND_ASSIGN(auto peak_memory,
+                        xla::HeapSimulator::MinimumMemoryForModule(
+                            module.schedule(), buffer_size));
+  if (peak_memory > memory_limit) {
+    LOG(WARNING) << "the peak memory of " << builder_->name() << " is "
+                 << peak_memory << " bytes after rematerialization, which "
+                 << "exceeds the limit of " << memory_limit << " bytes";
+  } else {
+    VLOG(2) << "the peak memory of " << builder_->name() << " is "
+            << peak_memory << " bytes after rematerialization";
+  }
+}
+
+void XlaGraphCompiler::DumpOptimizedHlo(
+    const xla::LocalExecutable& executable) {
+  const std::string& dump_dir = options_.xla_dump_hlo_dir();
+  if (dump_dir.empty()) {
+    return;
+  }
+  // The instructions are printed with their metadata, whose `op_type` and
+  // `op_name` are the OneFlow op they are lowered from.
+  const xla::HloModule& module = executable.executable()->module();
+  std::string dump_file_path =
+      absl::StrCat(dump_dir, "/", builder_->name(), ".optimized.hlo.txt");
+  std::ofstream ofs(dump_file_path.c_str(), std::ofstream::out);
+  CHECK(ofs.good()) << "can not dump hlo, please check if the directory ("
+                    << dump_dir << ") exists";
+  ofs << module.ToString();
+  ofs.close();
+}
+
 std::shared_ptr<Executable> XlaGraphCompiler::BuildExecutable(
     const std::vector<xla::Shape>& xla_input_shapes,
     const xla::Shape& xla_output_shape,
@@ -154,13 +385,30 @@ std::shared_ptr<Executable> XlaGraphCompiler::BuildExecutable(
   xla::LocalClient* client =
       resource_mgr::GetOrCreateLocalClient(this->device_);
 
+  // Recompute the activations to fit the memory limit if rematerialization
+  // is enabled, which is mainly for the clusters spanning forward and
+  // backward ops.
+  int64_t memory_limit = RematerializationMemoryLimit();
+  bool rematerialized = memory_limit > 0;
+  xla::XlaComputation rematerialized_computation;
+  if (rematerialized) {
+    rematerialized_computation = Rematerialize(computation, memory_limit);
+  }
+
   xla::ExecutableBuildOptions build_options;
   build_options.set_device_ordinal(this->device_ordinal_);
   build_options.set_result_layout(xla_output_shape);
+  SetupDebugOptions(&build_options, rematerialized);
   MOLA_CHECK_AND_ASSIGN(
       auto executables,
-      client->Compile(computation, argument_layouts, build_options));
+      client->Compile(
+          rematerialized ? rematerialized_computation : computation,
+          argument_layouts, build_options));
   CHECK(executables.size() == 1);
+  if (rematerialized) {
+    CheckPeakMemory(*executables.at(0), memory_limit);
+  }
+  DumpOptimizedHlo(*executables.at(0));
   return std::make_shared<XlaExecutable>(builder_->name(), this->device_,
                                          xla_input_shapes, xla_output_shape,
                                          std::move(executables.at(0)));
@@ -205,6 +453,8 @@ std::shared_ptr<Executable> XlaGraphCompiler::Compile(
     return_args[i] = ArgFromParameter(return_params[i]);
     arguments_.emplace(return_params[i].name(), return_args[i]);
   }
+  mixed_precision_type_ = MixedPrecisionType(options_, this->device_);
+
   std::vector<xla::Shape> input_shapes;
   xla::Shape output_shape;
   xla::XlaComputation computation;
@@ -18,7 +18,9 @@ limitations under the License.
 
 #include "oneflow_xrt/compiler/graph_compiler.h"
 #include "oneflow_xrt/compiler/xla/ops/op_context.h"
+#include "oneflow_xrt/compiler/xla/xla_attention_fusion.h"
 #include "oneflow_xrt/compiler/xla/xla_executable.h"
+#include "oneflow_xrt/compiler/xla/xla_mixed_precision.h"
 #include "tensorflow/compiler/xla/client/local_client.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/service/service.h"
@@ -48,14 +50,47 @@ class XlaGraphCompiler : public GraphCompiler::Impl {
       const xla::Shape& xla_output_shape,
       const xla::XlaComputation& computation);
 
+  // Merge the debug options of `options_` into the build options.
+  void SetupDebugOptions(xla::ExecutableBuildOptions* build_options,
+                         bool rematerialized);
+
+  // Returns the memory limit in bytes for rematerialization, or 0 if
+  // rematerialization is disabled.
+  int64_t RematerializationMemoryLimit() const;
+
+  xla::XlaComputation Rematerialize(const xla::XlaComputation& computation,
+                                    int64_t memory_limit);
+
+  // Log the peak memory of the optimized executable, and warn if it still
+  // exceeds the memory limit of rematerialization.
+  void CheckPeakMemory(const xla::LocalExecutable& executable,
+                       int64_t memory_limit);
+
+  // Dump the optimized HLO module if `xla_dump_hlo_dir` is set.
+  void DumpOptimizedHlo(const xla::LocalExecutable& executable);
+
   void SetupKernelContextParam(const XrtNode* node,
                                XlaOpContext::Param* context_param);
 
+  // Cast the float inputs and outputs of the kernel to the mixed precision
+  // type. The original float arguments of the outputs are returned by
+  // `float_outputs` so that they can be cast back after compiling.
+  void LowerKernelPrecision(
+      XlaOpContext::Param* context_param,
+      std::unordered_map<Argument, Argument>* float_outputs);
+
+  void SetKernelOutputs(
+      const std::unordered_map<Argument, XlaValue>& outputs,
+      const std::unordered_map<Argument, Argument>& float_outputs);
+
   void BuildComputation(const XrtGraph* graph,
                         const std::vector<Argument>& return_args,
                         xla::Shape* output_shape,
                         xla::XlaComputation* computation);
 
+  // Lower a matched attention chain as a blocked attention computation.
+  void BuildAttention(const AttentionPattern& pattern, int64_t block_size);
+
   void BuildEntryParameters(const std::vector<Parameter>& entry_params,
                             std::vector<xla::Shape>* input_shapes);
 
@@ -70,7 +105,14 @@ class XlaGraphCompiler : public GraphCompiler::Impl {
 
   std::unique_ptr<xla::XlaBuilder> builder_;
 
+  // The low precision type for mixed precision, or kInvalidDataType if
+  // mixed precision is disabled.
+  DataType mixed_precision_type_ = DataType::kInvalidDataType;
+
   std::unordered_map<Argument, XlaValue> operands_;
+  // Low precision copies of the float operands, which are reused to avoid
+  // casting an operand back and forth between two low precision kernels.
+  std::unordered_map<Argument, XlaValue> low_precision_operands_;
   std::unordered_map<std::string /* argument name */, Argument> arguments_;
 };
 
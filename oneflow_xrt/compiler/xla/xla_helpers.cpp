@@ -72,6 +72,13 @@ xla::XlaOp Reshape(xla::XlaOp input, Shape dest_shape) {
   return xla::Reshape(input, shape_dim);
 }
 
+DataType AccumulationType(DataType data_type) {
+  if (data_type == DataType::kFloat16 || data_type == DataType::kBFloat16) {
+    return DataType::kFloat;
+  }
+  return data_type;
+}
+
 xla::XlaOp MinValue(xla::XlaBuilder* builder, DataType data_type) {
   xla::PrimitiveType type = DataTypeToPrimitiveType(data_type);
   return xla::MinValue(builder, type);
@@ -102,6 +109,7 @@ OFXLA_CREATE_BINARY_COMPUTATION_FUNC(Add);
 OFXLA_CREATE_BINARY_COMPUTATION_FUNC(Sub);
 OFXLA_CREATE_BINARY_COMPUTATION_FUNC(Mul);
 OFXLA_CREATE_BINARY_COMPUTATION_FUNC(Div);
+OFXLA_CREATE_BINARY_COMPUTATION_FUNC(Ge);
 
 }  // namespace mola
 }  // namespace xrt
@@ -42,6 +42,11 @@ xla::XlaOp FloatLiteral(xla::XlaBuilder* builder, DataType data_type,
 
 xla::XlaOp Reshape(xla::XlaOp input, Shape dest_shape);
 
+// Returns the data type used to accumulate reductions over `data_type`.
+// Half precision types are accumulated by float and should be cast back
+// after the reduction.
+DataType AccumulationType(DataType data_type);
+
 xla::XlaOp MinValue(xla::XlaBuilder* builder, DataType data_type);
 xla::XlaOp MaxValue(xla::XlaBuilder* builder, DataType data_type);
 
@@ -59,6 +64,10 @@ xla::XlaComputation CreateMulFunc(DataType data_type);
 
 xla::XlaComputation CreateDivFunc(DataType data_type);
 
+// Create computation of greater-or-equal comparison, which is used to select
+// the first maximum of a window
+xla::XlaComputation CreateGeFunc(DataType data_type);
+
 }  // namespace mola
 }  // namespace xrt
 }  // namespace oneflow
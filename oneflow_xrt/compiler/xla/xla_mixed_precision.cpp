@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow_xrt/compiler/xla/xla_mixed_precision.h"
+
+#include <unordered_set>
+
+#include "glog/logging.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+namespace {
+
+const std::unordered_set<std::string>& AllowList() {
+  static const std::unordered_set<std::string> allow_list = {
+      "matmul", "batch_matmul", "fully_connected", "conv1d", "conv2d", "conv3d",
+      "conv_data_grad", "conv_filter_grad",
+  };
+  return allow_list;
+}
+
+const std::unordered_set<std::string>& InferList() {
+  static const std::unordered_set<std::string> infer_list = {
+      "add_n", "bias_add", "broadcast_add", "broadcast_sub", "broadcast_mul",
+      "scalar_add", "scalar_mul", "relu", "relu_grad", "gelu", "gelu_grad",
+      "tanh", "tanh_grad", "sigmoid", "sigmoid_v2", "identity", "reshape",
+      "reshape_like", "transpose", "gather", "batch_gather", "embedding",
+      "dropout", "dropout_grad", "where", "max_pool_2d", "max_pool_2d_grad",
+  };
+  return infer_list;
+}
+
+const std::unordered_set<std::string>& DenyList() {
+  static const std::unordered_set<std::string> deny_list = {
+      "softmax", "softmax_grad", "reduce_sum", "square_sum", "layer_norm",
+      "layer_norm_grad", "layer_norm_param_grad", "normalization",
+      "normalization_grad", "conv_bias_grad", "avg_pool_2d", "avg_pool_2d_grad",
+      "embedding_grad", "unsorted_segment_sum", "unsorted_segment_sum_like",
+      "unsorted_batch_segment_sum", "cast", "rsqrt", "sqrt", "scalar_pow",
+      "scalar_div", "broadcast_div", "adam_update", "sgd_update",
+      "momentum_update", "rmsprop_update", "lamb_update",
+  };
+  return deny_list;
+}
+
+}  // namespace
+
+DataType MixedPrecisionType(const ExecuteOptionsProto& options,
+                            const XrtDevice& device) {
+  if (options.use_bf16()) {
+    return DataType::kBFloat16;
+  }
+  if (options.use_fp16()) {
+    if (device == XrtDevice::GPU_CUDA) {
+      return DataType::kFloat16;
+    }
+    LOG_FIRST_N(WARNING, 1)
+        << "XLA ignores use_fp16 on the non-cuda devices, and set "
+           "use_bf16 to run in bfloat16 instead";
+  }
+  return DataType::kInvalidDataType;
+}
+
+bool IsLowPrecisionOp(const std::string& op_type, bool aggressive) {
+  if (DenyList().count(op_type)) {
+    return false;
+  }
+  return AllowList().count(op_type) ||
+         (aggressive && InferList().count(op_type));
+}
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
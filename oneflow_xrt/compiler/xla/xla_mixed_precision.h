@@ -0,0 +1,48 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_XRT_COMPILER_XLA_XLA_MIXED_PRECISION_H_
+#define ONEFLOW_XRT_COMPILER_XLA_XLA_MIXED_PRECISION_H_
+
+#include <string>
+
+#include "oneflow/core/common/data_type.pb.h"
+#include "oneflow_xrt/xrt.pb.h"
+
+namespace oneflow {
+namespace xrt {
+namespace mola {
+
+// Returns the low precision type that the float ops of a cluster are lowered
+// to, or kInvalidDataType if mixed precision is disabled. `use_bf16` always
+// chooses bfloat16, and `use_fp16` chooses float16 on cuda devices. XLA CPU
+// has no native float16, and bfloat16 is only fast on the cpus supporting
+// it, so `use_fp16` is ignored on the other devices and they need an
+// explicit `use_bf16`.
+DataType MixedPrecisionType(const ExecuteOptionsProto& options,
+                            const XrtDevice& device);
+
+// Returns true if the op should be computed in low precision. The ops in the
+// allow list (matmul and convolution) always run in low precision, the ops in
+// the infer list (elementwise and data movement) only run in low precision if
+// `aggressive` is set, and the ops in the deny list (reductions,
+// normalization, softmax and model update) always keep float.
+bool IsLowPrecisionOp(const std::string& op_type, bool aggressive);
+
+}  // namespace mola
+}  // namespace xrt
+}  // namespace oneflow
+
+#endif  // ONEFLOW_XRT_COMPILER_XLA_XLA_MIXED_PRECISION_H_
@@ -17,6 +17,10 @@ limitations under the License.
 
 #include <string>
 
+#include "oneflow/core/common/singleton.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/vm/symbol_storage.h"
 #include "oneflow_xrt/common/registry.h"
 #include "oneflow_xrt/compiler/kernel/op_kernel_registry.h"
 #include "oneflow_xrt/compiler/kernel/op_kernel_registry_id.h"
@@ -55,6 +59,19 @@ bool IsModelUpdateNode(const XrtNode* node) {
   return XRT_REGISTER_HAS(ModelUpdateRegId, node->type());
 }
 
+bool IsBackwardNode(const XrtNode* node) {
+  const auto& conf = node->conf();
+  if (!conf.has_scope_symbol_id()) {
+    return false;
+  }
+  const auto* storage = Singleton<symbol::Storage<Scope>>::Get();
+  if (!storage || !storage->Has(conf.scope_symbol_id())) {
+    return false;
+  }
+  const auto& scope = storage->Get(conf.scope_symbol_id());
+  return scope.scope_proto().calculation_pass_name() == kBackwardPass;
+}
+
 bool IsMutableVariable(const Argument& argument, const std::string& op_type,
                        const XrtEngine& engine) {
   const auto& kernel_attrs = XRT_REGISTER_LOOKUP(
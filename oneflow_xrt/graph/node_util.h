@@ -24,6 +24,9 @@ namespace xrt {
 bool IsCanbeCompiledNode(const XrtNode* node, const XrtEngine& engine,
                          const XrtDevice& device);
 bool IsModelUpdateNode(const XrtNode* node);
+// returns true if the node is generated by the autograd, i.e. its scope is in
+// the backward calculation pass
+bool IsBackwardNode(const XrtNode* node);
 
 bool IsMutableVariable(const Argument& argument, const std::string& op_type,
                        const XrtEngine& engine);
@@ -69,6 +69,15 @@ void InitClusteringOptionsApis(py::module_& m) {
           [](ClusteringOptions& opt, const bool& ignore_pipeline) {
             opt.ignore_pipeline = ignore_pipeline;
           })
+      .def_property(
+          "preserve_critical_path", /*getter*/
+          [](const ClusteringOptions& opt) {
+            return opt.preserve_critical_path;
+          },
+          /*setter*/
+          [](ClusteringOptions& opt, bool preserve_critical_path) {
+            opt.preserve_critical_path = preserve_critical_path;
+          })
       .def_property(
           "max_iteration", /*getter*/
           [](const ClusteringOptions& opt) { return opt.max_iteration; },
@@ -83,6 +92,36 @@ void InitClusteringOptionsApis(py::module_& m) {
           [](ClusteringOptions& opt, bool strict_sbp_policy) {
             opt.strict_sbp_policy = strict_sbp_policy;
           })
+      .def_property(
+          "horizontal_fusion", /*getter*/
+          [](const ClusteringOptions& opt) { return opt.horizontal_fusion; },
+          /*setter*/
+          [](ClusteringOptions& opt, bool horizontal_fusion) {
+            opt.horizontal_fusion = horizontal_fusion;
+          })
+      .def_property(
+          "fuse_model_update", /*getter*/
+          [](const ClusteringOptions& opt) { return opt.fuse_model_update; },
+          /*setter*/
+          [](ClusteringOptions& opt, bool fuse_model_update) {
+            opt.fuse_model_update = fuse_model_update;
+          })
+      .def_property(
+          "fuse_forward_backward", /*getter*/
+          [](const ClusteringOptions& opt) {
+            return opt.fuse_forward_backward;
+          },
+          /*setter*/
+          [](ClusteringOptions& opt, bool fuse_forward_backward) {
+            opt.fuse_forward_backward = fuse_forward_backward;
+          })
+      .def_property(
+          "cluster_random_ops", /*getter*/
+          [](const ClusteringOptions& opt) { return opt.cluster_random_ops; },
+          /*setter*/
+          [](ClusteringOptions& opt, bool cluster_random_ops) {
+            opt.cluster_random_ops = cluster_random_ops;
+          })
       .def_property(
           "dump_subgraph_dir", /*getter*/
           [](const ClusteringOptions& opt) { return opt.dump_subgraph_dir; },
@@ -103,6 +142,13 @@ void InitReBuildJobOptionsApis(py::module_& m) {
           [](ReBuildJobOptions& opt, const bool& use_fp16) {
             opt.use_fp16 = use_fp16;
           })
+      .def_property(
+          "use_bf16", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.use_bf16; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const bool& use_bf16) {
+            opt.use_bf16 = use_bf16;
+          })
       .def_property(
           "use_int8", /*getter*/
           [](const ReBuildJobOptions& opt) { return opt.use_int8; },
@@ -154,6 +200,74 @@ void InitReBuildJobOptionsApis(py::module_& m) {
           [](ReBuildJobOptions& opt, const int64_t& max_workspace_size) {
             opt.max_workspace_size = max_workspace_size;
           })
+      .def_property(
+          "num_streams", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.num_streams; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const int64_t& num_streams) {
+            opt.num_streams = num_streams;
+          })
+      .def_property(
+          "host_num_threads", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.host_num_threads; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const int64_t& host_num_threads) {
+            opt.host_num_threads = host_num_threads;
+          })
+      .def_property(
+          "host_thread_binding", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.host_thread_binding; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const std::string& host_thread_binding) {
+            opt.host_thread_binding = host_thread_binding;
+          })
+      .def_property(
+          "engine_cache_dir", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.engine_cache_dir; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const std::string& engine_cache_dir) {
+            opt.engine_cache_dir = engine_cache_dir;
+          })
+      .def_property(
+          "share_weights", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.share_weights; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const bool& share_weights) {
+            opt.share_weights = share_weights;
+          })
+      .def_property(
+          "xla_debug_options", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.xla_debug_options; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const std::string& xla_debug_options) {
+            opt.xla_debug_options = xla_debug_options;
+          })
+      .def_property(
+          "xla_dump_hlo_dir", /*getter*/
+          [](const ReBuildJobOptions& opt) { return opt.xla_dump_hlo_dir; },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const std::string& xla_dump_hlo_dir) {
+            opt.xla_dump_hlo_dir = xla_dump_hlo_dir;
+          })
+      .def_property(
+          "xla_rematerialization", /*getter*/
+          [](const ReBuildJobOptions& opt) {
+            return opt.xla_rematerialization;
+          },
+          /*setter*/
+          [](ReBuildJobOptions& opt, const bool& xla_rematerialization) {
+            opt.xla_rematerialization = xla_rematerialization;
+          })
+      .def_property(
+          "xla_aggressive_mixed_precision", /*getter*/
+          [](const ReBuildJobOptions& opt) {
+            return opt.xla_aggressive_mixed_precision;
+          },
+          /*setter*/
+          [](ReBuildJobOptions& opt,
+             const bool& xla_aggressive_mixed_precision) {
+            opt.xla_aggressive_mixed_precision = xla_aggressive_mixed_precision;
+          })
       .def_property(
           "dump_subgraph_dir", /*getter*/
           [](const ReBuildJobOptions& opt) { return opt.dump_subgraph_dir; },
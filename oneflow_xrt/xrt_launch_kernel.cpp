@@ -14,43 +14,84 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "absl/strings/str_cat.h"
-#include "google/protobuf/text_format.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 #include "oneflow_xrt/api/api_internal.h"
 #include "oneflow_xrt/common/device.h"
+#include "oneflow_xrt/common/env.h"
+#include "oneflow_xrt/common/fingerprint.h"
+#include "oneflow_xrt/common/launch_proto.h"
 #include "oneflow_xrt/compiler/compilation_cache.h"
 #include "oneflow_xrt/compiler/executable.h"
 #include "oneflow_xrt/compiler/graph_compiler.h"
 
-using google::protobuf::TextFormat;
-
 namespace oneflow {
 
 class XrtLaunchKernelState : public user_op::OpKernelState {
  public:
-  XrtLaunchKernelState(const xrt::XrtLaunchProto& proto,
+  XrtLaunchKernelState(const std::shared_ptr<const xrt::XrtLaunchProto>& proto,
+                       uint64_t function_hash, const std::string& op_name,
                        const ParallelDesc& parallel_desc)
       : proto_(proto),
-        parallel_desc_(parallel_desc),
-        compilation_cache_(new xrt::CompilationCache) {
-    for (const auto& entry : proto.liveout_entries()) {
+        function_hash_(function_hash),
+        cache_name_(op_name),
+        parallel_desc_(parallel_desc) {
+    for (const auto& entry : proto->liveout_entries()) {
       liveout_entries_.insert(entry);
     }
+    // the XLA executables only depend on the function, so the launch ops of
+    // the identical clusters share them through the process-wide cache. The
+    // cache name is bound to the canonical function, and the launch op falls
+    // back to its own cache if the fingerprint collides
+    std::string canonical_data;
+    bool shared = false;
+    if (proto->options().engine() == xrt::XrtEngine::XLA &&
+        EnvToBool(ONEFLOW_XRT_XLA_SHARE_EXECUTABLES, true) &&
+        xrt::CanonicalizeLaunchProto(*proto, &canonical_data)) {
+      std::string shared_name =
+          absl::StrCat("xla-shared/", xrt::Fingerprint64(canonical_data));
+      shared = xrt::SharedCompilationCache()->BindContent(shared_name,
+                                                          canonical_data);
+      if (shared) {
+        cache_name_ = shared_name;
+      } else {
+        LOG(WARNING) << "structural fingerprint of launch op " << op_name
+                     << " collides, so its executables are not shared";
+      }
+    }
+    if (shared) {
+      compilation_cache_ = xrt::SharedCompilationCache();
+    } else {
+      owned_compilation_cache_ = std::make_unique<xrt::CompilationCache>();
+      compilation_cache_ = owned_compilation_cache_.get();
+    }
+  }
+  virtual ~XrtLaunchKernelState() {
+    // the shared executables are released with the last launch op using them
+    if (!owned_compilation_cache_) {
+      compilation_cache_->UnbindContent(cache_name_);
+    }
   }
-  const xrt::XrtLaunchProto& proto() const { return proto_; }
+  const xrt::XrtLaunchProto& proto() const { return *proto_; }
+  const std::shared_ptr<const xrt::XrtLaunchProto>& shared_proto() const {
+    return proto_;
+  }
+  uint64_t function_hash() const { return function_hash_; }
+  // name of the executables in the compilation cache
+  const std::string& cache_name() const { return cache_name_; }
   const std::set<std::string>& liveout_entries() { return liveout_entries_; }
 
   const ParallelDesc& parallel_desc() const { return parallel_desc_; }
 
-  xrt::CompilationCache* compilation_cache() {
-    return compilation_cache_.get();
-  }
+  xrt::CompilationCache* compilation_cache() { return compilation_cache_; }
 
  private:
-  xrt::XrtLaunchProto proto_;
+  std::shared_ptr<const xrt::XrtLaunchProto> proto_;
+  uint64_t function_hash_;
+  std::string cache_name_;
   std::set<std::string> liveout_entries_;
   ParallelDesc parallel_desc_;
-  std::shared_ptr<xrt::CompilationCache> compilation_cache_;
+  xrt::CompilationCache* compilation_cache_ = nullptr;
+  std::unique_ptr<xrt::CompilationCache> owned_compilation_cache_;
 };
 
 static xrt::Parameter BuildParameter(const std::string& name,
@@ -92,11 +133,13 @@ class XrtLaunchKernel : public user_op::OpKernel {
 std::shared_ptr<user_op::OpKernelState> XrtLaunchKernel::CreateOpKernelState(
     user_op::KernelInitContext* ctx) const {
   const auto& string_proto = ctx->Attr<std::string>("proto");
-  xrt::XrtLaunchProto proto;
-  if (!TextFormat::ParseFromString(string_proto, &proto)) {
+  auto proto = xrt::ParseLaunchProto(string_proto);
+  if (!proto) {
     LOG(FATAL) << "failed to parse proto for xrt launch op " << ctx->op_name();
   }
-  return std::make_shared<XrtLaunchKernelState>(proto, ctx->parallel_desc());
+  return std::make_shared<XrtLaunchKernelState>(
+      proto, xrt::Fingerprint64(string_proto), ctx->op_name(),
+      ctx->parallel_desc());
 }
 
 std::shared_ptr<xrt::Executable> XrtLaunchKernel::BuildExecutable(
@@ -107,8 +150,6 @@ std::shared_ptr<xrt::Executable> XrtLaunchKernel::BuildExecutable(
     const xrt::XrtEngine& engine, const xrt::XrtDevice& device,
     const int device_ordinal) const {
   VLOG(2) << "build an executable for launch op " << ctx->op_name();
-  auto graph = xrt::BuildGraph(launch_state->proto().function());
-
   std::map<std::string, BlobDesc> entry_blob_descs;
   for (const auto& input : ctx->inputs()) {
     std::string name = absl::StrCat(input.first, "_", input.second);
@@ -118,15 +159,17 @@ std::shared_ptr<xrt::Executable> XrtLaunchKernel::BuildExecutable(
         name, BlobDesc(tensor_desc->shape(), tensor_desc->data_type(),
                        tensor_desc->is_dynamic()));
   }
-  // the infered shape will be filled to the graph
-  xrt::ShapeInferenceContext context(
-      &entry_blob_descs, &launch_state->proto().logical_blob_descs(),
-      &ctx->parallel_ctx(), &launch_state->parallel_desc(),
-      &launch_state->proto().nd_sbp_signatures());
-  xrt::RunShapeInferencePass(graph.get(), context);
+  // the infered shape has been filled to the graph, and the graph is shared
+  // with the physical tensor desc inference if the inputs are the same
+  auto infered_function = xrt::InferFunctionPhysicalShapes(
+      launch_state->function_hash(), launch_state->shared_proto(),
+      entry_blob_descs, ctx->parallel_ctx(), launch_state->parallel_desc());
 
   xrt::GraphCompiler compiler(ctx->op_name(), engine, device, device_ordinal);
-  return compiler.Compile(graph.get(), entry_params, return_params, aliases);
+  compiler.set_options(launch_state->proto().options());
+  compiler.set_fingerprint(launch_state->function_hash());
+  return compiler.Compile(infered_function->graph.get(), entry_params,
+                          return_params, aliases);
 }
 
 void XrtLaunchKernel::MakeInputOutputAlias(
@@ -178,11 +221,24 @@ void XrtLaunchKernel::Compute(user_op::KernelComputeContext* ctx,
   xrt::XrtDevice device = options.device();
   int device_ordinal = xrt::GetDeviceId(device);
 
-  xrt::Executable* executable = nullptr;
-  xrt::Signature signature =
-      xrt::ComputeSignature(ctx->op_name(), device_ordinal, entry_params);
+  // the executable is held while running, since the record may be replaced
+  // by the other launch ops sharing the cache
+  std::shared_ptr<xrt::Executable> executable;
+  std::shared_ptr<xrt::Executable> outdated;
+  xrt::Signature signature = xrt::ComputeSignature(
+      launch_state->cache_name(), device_ordinal, entry_params);
+  auto* compilation_cache = launch_state->compilation_cache();
   if (!options.force_compile()) {
-    executable = launch_state->compilation_cache()->GetRecord(signature);
+    executable = compilation_cache->GetRecord(signature);
+    if (!executable) {
+      executable =
+          compilation_cache->GetCompatibleRecord(signature, entry_params);
+    }
+    if (executable && executable->IsOutdated(entry_params)) {
+      VLOG(2) << "recompile the outdated executable for launch op "
+              << ctx->op_name();
+      outdated = std::move(executable);
+    }
   }
   if (!executable) {
     auto result =
@@ -191,8 +247,10 @@ void XrtLaunchKernel::Compute(user_op::KernelComputeContext* ctx,
     if (!result) {
       LOG(FATAL) << "failed to build an executable";
     }
-    executable = result.get();
-    launch_state->compilation_cache()->Record(signature, result);
+    // run the record compiled by the other launch ops if any, unless the
+    // compilation is forced
+    auto record = compilation_cache->Record(signature, result, outdated.get());
+    executable = options.force_compile() ? result : record;
   }
 
   xrt::ExecutableRunOptions run_options;
@@ -209,10 +267,11 @@ void XrtLaunchKernel::Compute(user_op::KernelComputeContext* ctx,
         << "Unable access cuda device since XRT was compiled without CUDA";
 #endif  // WITH_CUDA
   }
-  bool status = executable->Run(entry_params, run_options, block_until_done);
+  std::vector<xrt::Parameter> results;
+  bool status =
+      executable->Run(entry_params, run_options, &results, block_until_done);
   CHECK(status) << "failed to run executable";
 
-  const std::vector<xrt::Parameter>& results = executable->Results();
   CHECK_EQ(results.size(), return_params.size());
   for (int i = 0; i < results.size(); ++i) {
     CHECK_EQ(results[i].data(), return_params[i].data());
@@ -14,13 +14,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "absl/strings/str_cat.h"
-#include "google/protobuf/text_format.h"
 #include "oneflow/core/framework/framework.h"
 #include "oneflow_xrt/api/api_internal.h"
+#include "oneflow_xrt/common/fingerprint.h"
+#include "oneflow_xrt/common/launch_proto.h"
 #include "oneflow_xrt/common/typedef.h"
 
-using google::protobuf::TextFormat;
-
 namespace oneflow {
 
 namespace {
@@ -35,15 +34,15 @@ const char* kUserSourceOpTickInputArgName = "UserSourceOpTickInput";
 }  // namespace
 
 Maybe<void> XrtLaunchOpInferNdSbp(user_op::InferNdSbpFnContext* ctx) {
-  const auto& string_proto = ctx->user_op_conf().attr<std::string>("proto");
-  xrt::XrtLaunchProto proto;
-  if (!TextFormat::ParseFromString(string_proto, &proto)) {
+  auto proto =
+      xrt::ParseLaunchProto(ctx->user_op_conf().attr<std::string>("proto"));
+  if (!proto) {
     return Error::RuntimeError() << "failed to parse proto for xrt launch op "
                                  << ctx->user_op_conf().op_name();
   }
   const std::string& op_name = ctx->user_op_conf().op_name();
-  auto it = proto.nd_sbp_signatures().find(op_name);
-  if (it == proto.nd_sbp_signatures().end()) {
+  auto it = proto->nd_sbp_signatures().find(op_name);
+  if (it == proto->nd_sbp_signatures().end()) {
     return Error::RuntimeError()
            << "can not infer nd sbp for xrt launch op " << op_name;
   }
@@ -80,13 +79,12 @@ Maybe<void> XrtLaunchOpInferNdSbp(user_op::InferNdSbpFnContext* ctx) {
 }
 
 Maybe<void> XrtLaunchOpInferLogicalTensorDesc(user_op::InferContext* ctx) {
-  const auto& string_proto = ctx->Attr<std::string>("proto");
-  xrt::XrtLaunchProto proto;
-  if (!TextFormat::ParseFromString(string_proto, &proto)) {
+  auto proto = xrt::ParseLaunchProto(ctx->Attr<std::string>("proto"));
+  if (!proto) {
     return Error::RuntimeError()
            << "failed to parse proto for xrt launch op " << ctx->op_name();
   }
-  const auto& logical_blob_descs = proto.logical_blob_descs();
+  const auto& logical_blob_descs = proto->logical_blob_descs();
   for (const auto& output : ctx->outputs()) {
     std::string name = absl::StrCat(output.first, "_", output.second);
     const auto& it = logical_blob_descs.find(name);
@@ -107,8 +105,8 @@ Maybe<void> XrtLaunchOpInferLogicalTensorDesc(user_op::InferContext* ctx) {
 
 Maybe<void> XrtLaunchOpInferPhysicalTensorDesc(user_op::InferContext* ctx) {
   const auto& string_proto = ctx->Attr<std::string>("proto");
-  xrt::XrtLaunchProto proto;
-  if (!TextFormat::ParseFromString(string_proto, &proto)) {
+  auto proto = xrt::ParseLaunchProto(string_proto);
+  if (!proto) {
     return Error::RuntimeError()
            << "failed to parse proto for xrt launch op " << ctx->op_name();
   }
@@ -121,13 +119,11 @@ Maybe<void> XrtLaunchOpInferPhysicalTensorDesc(user_op::InferContext* ctx) {
         name, BlobDesc(tensor_desc.shape(), tensor_desc.data_type(),
                        tensor_desc.is_dynamic()));
   }
-  xrt::ShapeInferenceContext context(
-      &entry_blob_descs, &proto.logical_blob_descs(), &ctx->parallel_ctx(),
-      &ctx->parallel_desc(), &proto.nd_sbp_signatures());
-  auto graph = xrt::BuildGraph(proto.function());
-  xrt::RunShapeInferencePass(graph.get(), context);
+  auto infered_function = xrt::InferFunctionPhysicalShapes(
+      xrt::Fingerprint64(string_proto), proto, entry_blob_descs,
+      ctx->parallel_ctx(), ctx->parallel_desc());
 
-  const auto* infered_blob_descs = context.infered_physical_blob_descs();
+  const auto* infered_blob_descs = &infered_function->physical_blob_descs;
   for (const auto& output : ctx->outputs()) {
     std::string name = absl::StrCat(output.first, "_", output.second);
     const auto& it = infered_blob_descs->find(name);
@@ -153,13 +149,12 @@ Maybe<void> XrtLaunchOpInferDataType(user_op::InferContext* ctx) {
 Maybe<void> XrtLaunchOpModifyInputArg(
     const user_op::GetInputArgModifier& GetInputArgModifierFn,
     const user_op::UserOpConfWrapper& conf) {
-  const auto& string_proto = conf.attr<std::string>("proto");
-  xrt::XrtLaunchProto proto;
-  if (!TextFormat::ParseFromString(string_proto, &proto)) {
+  auto proto = xrt::ParseLaunchProto(conf.attr<std::string>("proto"));
+  if (!proto) {
     return Error::RuntimeError()
            << "failed to parse proto for xrt launch op " << conf.op_name();
   }
-  for (const auto& entry : proto.liveout_entries()) {
+  for (const auto& entry : proto->liveout_entries()) {
     std::string arg_name = entry;
     int index = 0;
     size_t pos = entry.rfind("_");
@@ -31,9 +31,9 @@ class XRTModule(flow.nn.Module):
         - use_int8:
             If use int8 precision. Default: False
         - int8_calibration:
-            The directory of TensorRT style int8 calibration table. Default: None
+            The directory of int8 calibration table, which is TensorRT style for TensorRT, or has a "<tensor> <min> <max>" line per tensor for OpenVINO. Default: None
         - max_batch_size:
-            The maximum batch size for training or inference. Default: 1
+            The maximum batch size for training or inference. OpenVINO compiles the network once for it and runs the smaller batches by dynamic batch. Default: 1
         - max_workspace_size:
             The maximum available workspace for XRT. Default: None
         - strict_types:
@@ -61,6 +61,54 @@ class XRTModule(flow.nn.Module):
         - verbose:
             If output some details. Default: False
 
+    Keyword-only Args:
+        - use_bf16:
+            If use bf16 precision, which is supported by OpenVINO on the CPUs with AVX512-BF16 or AMX. XLA runs the matmul and
+            convolution ops in bf16, and it is the only way to enable low precision for XLA on CPU. Default: False
+        - num_streams:
+            The number of inference streams for the engines supporting multiple streams (OpenVINO).
+            More streams improve the throughput of concurrent executions, and 0 means it is decided by the engine. Default: 1
+        - host_num_threads:
+            The number of host threads used by the engine (OpenVINO). If None, it is decided by the engine,
+            and the cores are divided equally by the processes on the same machine. Default: None
+        - host_thread_binding:
+            Bind the host threads of the engine (OpenVINO) to "NONE", "CORE" or "NUMA". If None, it is decided by the engine. Default: None
+        - engine_cache_dir:
+            The directory to save the compiled results of the engine (OpenVINO), which are reused by the later processes to reduce the cold-start time. Default: None
+        - share_weights:
+            Share all the weights with the engine (OpenVINO) without copying them. The trainable variables and the weights updated
+            by the cluster are always shared, and the other weights are folded into the compiled result as constants, which is
+            recompiled once the weights are moved. The constants modified in place are only detected if the environment variable
+            ONEFLOW_XRT_OPENVINO_CHECK_FOLDED_WEIGHTS is set. Default: False
+        - xla_debug_options:
+            Extra XLA debug options in the text format of xla.DebugOptions, such as "xla_cpu_enable_fast_math: false".
+            They are merged into the defaults and XLA_FLAGS when compiling the XLA clusters. Default: None
+        - xla_dump_hlo_dir:
+            The directory to dump the optimized HLO of each XLA cluster, whose instructions are annotated with the OneFlow op names. Default: None
+        - xla_rematerialization:
+            Recompute the activations in the XLA clusters instead of keeping them alive, so that the peak memory of each cluster fits in max_workspace_size (in bytes).
+            It is skipped if max_workspace_size is None, and works best with cluster_fuse_forward_backward. The peak memory of the
+            compiled cluster is measured again, and a warning is logged if it still exceeds max_workspace_size. Default: False
+        - xla_aggressive_mixed_precision:
+            Also run the elementwise and data movement ops of the XLA clusters in low precision if use_fp16 or use_bf16 is set,
+            rather than only the matmul and convolution ops. Default: False
+        - cluster_preserve_critical_path:
+            Reject the merges that lengthen the estimated critical path of the graph, so that the overlap between independent branches (such as compute and communication) is kept.
+            It replaces the strict dependencies check if cluster_ignore_pipeline is False. Default: False
+        - cluster_horizontal_fusion:
+            Merge independent sibling clusters consuming the same input into one cluster to reduce the number of launch ops.
+            It changes the number and sizes of the clusters, so it is disabled unless set explicitly. Default: False
+        - cluster_fuse_model_update:
+            Compile the optimizer update ops (such as sgd_update, momentum_update, adam_update, lamb_update and rmsprop_update) supported by the engine.
+            They are only merged with each other, so the updates of all parameters sharing the same learning rate run as one fused computation.
+            The update ops with skip_if (dynamic loss scaling) or without the learning_rate input are not compiled. Default: False
+        - cluster_fuse_forward_backward:
+            Allow the backward ops to be merged into the clusters of the forward ops they depend on, even if cluster_ignore_pipeline is False or
+            cluster_preserve_critical_path is True, so that the activations can be rematerialized within the cluster. Default: False
+        - cluster_random_ops:
+            Compile the random ops (dropout and random_mask_like). The compiled kernels draw from the engine's generator and ignore
+            the seed and the generator of the ops, so the results are not reproducible by flow.manual_seed. Default: False
+
     For example:
 
     .. code-block:: python
@@ -94,6 +142,22 @@ class XRTModule(flow.nn.Module):
         cluster_strict_sbp_policy=True,
         dump_subgraph_dir=None,
         verbose=False,
+        *,
+        use_bf16=False,
+        num_streams=1,
+        host_num_threads=None,
+        host_thread_binding=None,
+        engine_cache_dir=None,
+        share_weights=False,
+        xla_debug_options=None,
+        xla_dump_hlo_dir=None,
+        xla_rematerialization=False,
+        xla_aggressive_mixed_precision=False,
+        cluster_preserve_critical_path=False,
+        cluster_horizontal_fusion=False,
+        cluster_fuse_model_update=False,
+        cluster_fuse_forward_backward=False,
+        cluster_random_ops=False,
     ):
         super().__init__()
         assert not isinstance(module, XRTModule)
@@ -114,6 +178,11 @@ class XRTModule(flow.nn.Module):
             cluster_max_iteration,
             cluster_strict_sbp_policy,
             dump_subgraph_dir,
+            preserve_critical_path=cluster_preserve_critical_path,
+            horizontal_fusion=cluster_horizontal_fusion,
+            fuse_model_update=cluster_fuse_model_update,
+            fuse_forward_backward=cluster_fuse_forward_backward,
+            random_ops=cluster_random_ops,
         )
         self.execution_options = self.make_execution_options(
             use_fp16,
@@ -125,6 +194,16 @@ class XRTModule(flow.nn.Module):
             force_precision_constraints,
             force_compile,
             dump_subgraph_dir,
+            use_bf16=use_bf16,
+            num_streams=num_streams,
+            host_num_threads=host_num_threads,
+            host_thread_binding=host_thread_binding,
+            engine_cache_dir=engine_cache_dir,
+            share_weights=share_weights,
+            xla_debug_options=xla_debug_options,
+            xla_dump_hlo_dir=xla_dump_hlo_dir,
+            xla_rematerialization=xla_rematerialization,
+            xla_aggressive_mixed_precision=xla_aggressive_mixed_precision,
         )
         self.verbose = verbose
 
@@ -181,14 +260,25 @@ class XRTModule(flow.nn.Module):
         max_iteration=20,
         strict_sbp_policy=True,
         dump_subgraph_dir=None,
+        *,
+        preserve_critical_path=False,
+        horizontal_fusion=False,
+        fuse_model_update=False,
+        fuse_forward_backward=False,
+        random_ops=False,
     ):
         options = ofrt.ClusteringOptions()
         options.minimum_nodes = minimum_nodes
         if maximum_nodes is not None:
             options.maximum_nodes = maximum_nodes
         options.ignore_pipeline = ignore_pipeline
+        options.preserve_critical_path = preserve_critical_path
         options.max_iteration = max_iteration
         options.strict_sbp_policy = strict_sbp_policy
+        options.horizontal_fusion = horizontal_fusion
+        options.fuse_model_update = fuse_model_update
+        options.fuse_forward_backward = fuse_forward_backward
+        options.cluster_random_ops = random_ops
         if dump_subgraph_dir is not None:
             options.dump_subgraph_dir = dump_subgraph_dir
         return options
@@ -204,15 +294,41 @@ class XRTModule(flow.nn.Module):
         force_precision_constraints=True,
         force_compile=False,
         dump_subgraph_dir=None,
+        *,
+        use_bf16=False,
+        num_streams=1,
+        host_num_threads=None,
+        host_thread_binding=None,
+        engine_cache_dir=None,
+        share_weights=False,
+        xla_debug_options=None,
+        xla_dump_hlo_dir=None,
+        xla_rematerialization=False,
+        xla_aggressive_mixed_precision=False,
     ):
         options = ofrt.ReBuildJobOptions()
         options.use_fp16 = use_fp16
+        options.use_bf16 = use_bf16
         options.use_int8 = use_int8
         if int8_calibration is not None:
             options.int8_calibration = int8_calibration
         options.max_batch_size = max_batch_size
         if max_workspace_size is not None:
             options.max_workspace_size = max_workspace_size
+        options.num_streams = num_streams
+        if host_num_threads is not None:
+            options.host_num_threads = host_num_threads
+        if host_thread_binding is not None:
+            options.host_thread_binding = host_thread_binding.upper()
+        if engine_cache_dir is not None:
+            options.engine_cache_dir = engine_cache_dir
+        options.share_weights = share_weights
+        if xla_debug_options is not None:
+            options.xla_debug_options = xla_debug_options
+        if xla_dump_hlo_dir is not None:
+            options.xla_dump_hlo_dir = xla_dump_hlo_dir
+        options.xla_rematerialization = xla_rematerialization
+        options.xla_aggressive_mixed_precision = xla_aggressive_mixed_precision
         options.strict_types = strict_types
         options.force_precision_constraints = force_precision_constraints
         options.force_compile = force_compile